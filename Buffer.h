@@ -0,0 +1,105 @@
+/*
+** 伸長可能なチャンク列のバッファ
+*/
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <cstring>
+
+template <typename T>
+class Buffer {
+  struct Chunk {
+    T *data;                      // 要素の格納場所
+    int size;                     // 格納できる要素数
+    Chunk *next;                  // 次のチャンク
+  } *head, *tail;                 // チャンク列の先頭と末尾
+  int used;                       // 末尾のチャンクに格納した要素数
+  int count;                      // 格納した要素の総数
+  int first;                      // 最初のチャンクに格納できる要素数
+
+  // 要素数 n のチャンクを末尾に追加する
+  void grow(int n)
+  {
+    Chunk *c = new Chunk;
+    c->data = new T[n];
+    c->size = n;
+    c->next = 0;
+    if (tail) tail->next = c; else head = c;
+    tail = c;
+    used = 0;
+  };
+
+  // コピーは禁止
+  Buffer(const Buffer &);
+  Buffer &operator=(const Buffer &);
+
+public:
+  Buffer(int n = 1024) : head(0), tail(0), used(0), count(0), first(n > 0 ? n : 1) {};
+  virtual ~Buffer() { clear(); };
+
+  // 末尾に要素をひとつ確保する（チャンクが満杯なら倍々で追加する）
+  T &push()
+  {
+    if (tail == 0) grow(first);
+    else if (used == tail->size) grow(count);
+    ++count;
+    return tail->data[used++];
+  };
+
+  // 末尾に連続した n 個の要素を確保する（入り切らなければ次のチャンクに確保する）
+  T *push(int n)
+  {
+    if (tail == 0) grow(first > n ? first : n);
+    else if (used + n > tail->size) {
+      tail->size = used;
+      grow(count > n ? count : n);
+    }
+    count += n;
+    T *p = tail->data + used;
+    used += n;
+    return p;
+  };
+
+  // 格納した要素数
+  int size() const { return count; };
+
+  // 格納した要素を連続した配列として引き取る（呼び出し側が delete[] する）
+  T *adopt()
+  {
+    T *a;
+
+    if (head != 0 && head == tail) {
+      // チャンクがひとつならその配列をそのまま引き渡す
+      a = head->data;
+      head->data = 0;
+    }
+    else {
+      // 複数のチャンクはひとつの配列に詰め直す
+      a = new T[count > 0 ? count : 1];
+      T *d = a;
+      for (Chunk *c = head; c; c = c->next) {
+        const int n = c == tail ? used : c->size;
+        memcpy(d, c->data, n * sizeof (T));
+        d += n;
+      }
+    }
+    clear();
+
+    return a;
+  };
+
+  // 格納した要素をすべて捨てる
+  void clear()
+  {
+    while (head) {
+      Chunk *c = head;
+      head = c->next;
+      delete[] c->data;
+      delete c;
+    }
+    tail = 0;
+    used = count = 0;
+  };
+};
+
+#endif
@@ -0,0 +1,117 @@
+/*
+** 生成文法で書き換えたタートルの命令列
+*/
+#include <map>
+#include <vector>
+#include "Buffer.h"
+#include "Expansion.h"
+#include "Grammar.h"
+#include "Stream.h"
+#include "Turtle.h"
+
+/*
+** コンストラクタ
+**   初期文字列を書き換えて, タートルが処理しない記号を除いた命令列を作る
+**   木を生成するのは Tree で, 同じ命令列から角度や半径を変えて何度でも生成できる
+**   パラメータ付きの規則は扱わない
+*/
+Expansion::Expansion(const char *initial, const char * const *rule, int level,
+                     unsigned long long seed)
+  : nforward(0), npop(0), nest(0)
+{
+  const Grammar grammar(rule);
+  Buffer<char> buffer;
+
+  if (grammar.sensitive()) {
+    // 文脈のある規則は各再帰レベルの文字列を作って書き換える
+    std::vector<char> s;
+    grammar.rewrite(initial, level, seed, s);
+
+    for (std::vector<char>::size_type i = 0; i < s.size(); ++i)
+      if (Turtle::accepts(s[i])) buffer.push() = s[i];
+  }
+  else {
+    // 文脈のない規則は作業スタックだけで書き換えながら取り出す
+    Stream stream(grammar, initial, level, seed);
+
+    for (char c; (c = stream.next()) != '\0';)
+      if (Turtle::accepts(c)) buffer.push() = c;
+  }
+
+  ncommand = buffer.size();
+  command = buffer.adopt();
+
+  for (int i = 0, d = 0; i < ncommand; ++i) {
+    if (command[i] == 'F') ++nforward;
+    else if (command[i] == '[') {
+      if (++d > nest) nest = d;
+    }
+    else if (command[i] == ']') {
+      --d;
+      ++npop;
+    }
+  }
+}
+
+/*
+** デストラクタ
+*/
+Expansion::~Expansion()
+{
+  delete[] command;
+  command = 0;
+}
+
+/*
+** 回転の命令なら true
+*/
+static bool rotation(char c)
+{
+  return c == '+' || c == '-' || c == '<' || c == '>';
+}
+
+/*
+** 命令列の最適化
+**   節点を作らずに続く回転 (+-<>) の並びはひとつの回転にまとめて TURN + 番号の命令にする
+**   ] の直前と命令列の最後の回転は座標系が捨てられるだけなので取り除く
+**   （[ ] の組は中に F がなくても ] で節点と分岐を作るので取り除けない）
+**   取り除く回転は結果を変えないが, まとめた回転は四元数の積を先に求めておくので積の順序が
+**   変わり, 骨格の頂点位置は最適化しないものと丸め誤差の範囲でしか一致しない
+**   （付属の文法では座標値の差は 1e-14 未満で, ほとんどの座標値はビット単位で一致する）
+*/
+void Expansion::optimize()
+{
+  std::map<std::string, int> index;
+  for (int k = 0; k < turns(); ++k) index[run[k]] = k;
+
+  int j = 0;
+  for (int i = 0; i < ncommand;) {
+    if (!rotation(command[i])) {
+      command[j++] = command[i++];
+      continue;
+    }
+
+    // 回転の並びの終わりを探す
+    int k = i;
+    while (k < ncommand && rotation(command[k])) ++k;
+
+    if (k < ncommand && command[k] != ']') {
+      const std::string r(command + i, command + k);
+      std::map<std::string, int>::iterator p = index.find(r);
+
+      if (p == index.end() && turns() < LIMIT) {
+        p = index.insert(std::make_pair(r, turns())).first;
+        run.push_back(r);
+      }
+
+      if (p != index.end())
+        command[j++] = static_cast<char>(TURN + p->second);
+      else
+        while (i < k) command[j++] = command[i++];
+    }
+
+    i = k;
+  }
+
+  ncommand = j;
+}
@@ -0,0 +1,73 @@
+/*
+** 生成文法で書き換えたタートルの命令列
+*/
+#ifndef EXPANSION_H
+#define EXPANSION_H
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Preset.h"
+
+class Expansion {
+  char *command;                  // タートルが処理する記号だけを残した命令列
+  int ncommand;                   // 命令の数
+  int nforward;                   // 前進 (F) の数
+  int npop;                       // 保存位置復帰 (]) の数
+  int nest;                       // 現在位置保存 ([) の入れ子の深さの最大値
+  std::vector<std::string> run;   // 最適化でまとめた回転の並び
+
+  // コピーは禁止
+  Expansion(const Expansion &);
+  Expansion &operator=(const Expansion &);
+
+public:
+  enum {
+    TURN = 0x80,                  // まとめた回転の並びの命令（TURN + 並びの番号）
+    LIMIT = 0x80                  // まとめられる回転の並びの種類の上限
+  };
+
+  Expansion(
+    const char *initial,          // 初期文字列
+    const char * const *rule,     // 書き換え規則
+    int level,                    // 再帰レベル
+    unsigned long long seed = 0   // 確率的な規則の乱数の種
+    );
+
+  // コンパイル時に書き換えた命令の表から作る（書き換えも数え上げも済んでいる）
+  template <unsigned long long N>
+  Expansion(const Preset::Table<N> &table)
+    : ncommand(table.size()), nforward(table.forward()), npop(table.pop()), nest(table.depth())
+  {
+    command = new char[N > 0 ? N : 1];
+    memcpy(command, table.data(), N);
+  };
+
+  virtual ~Expansion();
+
+  // 命令列（最適化後は TURN 以上の値の命令を含む）
+  const char *data() const { return command; };
+
+  // TURN + k の命令の回転の並び
+  const char *turn(int k) const { return run[k].c_str(); };
+
+  // まとめた回転の並びの種類
+  int turns() const { return static_cast<int>(run.size()); };
+
+  // 回転の並びをまとめて結果を変えない回転を取り除く（結果は丸め誤差の範囲で一致する）
+  void optimize();
+
+  // 命令の数
+  int size() const { return ncommand; };
+
+  // 生成される骨格の頂点数（根元と F と ] で節点がひとつずつ増える）
+  int nodes() const { return 1 + nforward + npop; };
+
+  // 生成される分岐の数（最後に終端の分岐が加わる）
+  int branches() const { return 1 + npop; };
+
+  // タートルが保存する座標系の数の最大値
+  int depth() const { return nest; };
+};
+
+#endif
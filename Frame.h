@@ -0,0 +1,32 @@
+/*
+** 回転と平行移動だけからなる座標系
+*/
+#ifndef FRAME_H
+#define FRAME_H
+
+class Frame {
+  double q[4];                    // 回転を表す単位四元数 (w, x, y, z)
+  double p[3];                    // 原点の位置
+  void spin(const double *b);
+  void matrix(double *r) const;
+
+public:
+  Frame() { loadIdentity(); };
+  ~Frame() {};                    // 派生しないので仮想関数表を持たせない（保存する座標系を小さくする）
+
+  Frame &loadIdentity();
+  Frame &multiply(const Frame &frame);
+  Frame &translate(double x, double y, double z);
+  Frame &translate(const double *v) { return translate(v[0], v[1], v[2]); };
+  Frame &rotate(double a, double x, double y, double z);
+  Frame &rotate(double a, const double *v) { return rotate(a, v[0], v[1], v[2]); };
+
+  void orient(const double *v1, double *v2) const;
+  void transform(const double (*v1)[3], double (*v2)[3], int n) const;
+  void transform(const float (*v1)[3], float (*v2)[3], int n) const;
+
+  // 原点の位置
+  const double *position() const { return p; };
+};
+
+#endif
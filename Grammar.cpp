@@ -0,0 +1,654 @@
+/*
+** L-System の生成文法
+*/
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "Grammar.h"
+
+/*
+** 上限で飽和する和と積（数え切れないほど大きいものは ULLONG_MAX とする）
+*/
+static unsigned long long add(unsigned long long a, unsigned long long b)
+{
+  return a > ULLONG_MAX - b ? ULLONG_MAX : a + b;
+}
+
+static unsigned long long mul(unsigned long long a, unsigned long long b)
+{
+  return a != 0 && b > ULLONG_MAX / a ? ULLONG_MAX : a * b;
+}
+
+/*
+** 行列の積
+**   n 次の正方行列 a と b を掛けたものを c に格納する（c は a, b と別の領域）
+*/
+static void multiply(const unsigned long long *a, const unsigned long long *b,
+                     unsigned long long *c, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    for (int j = 0; j < n; ++j) {
+      unsigned long long t = 0;
+
+      for (int k = 0; k < n; ++k)
+        if (a[i * n + k] != 0) t = add(t, mul(a[i * n + k], b[k * n + j]));
+      c[i * n + j] = t;
+    }
+  }
+}
+
+/*
+** ベクトルと行列の積
+**   n 要素のベクトル v に n 次の正方行列 a を掛けたものを w に格納する
+*/
+static void transform(const unsigned long long *v, const unsigned long long *a,
+                      unsigned long long *w, int n)
+{
+  for (int j = 0; j < n; ++j) {
+    unsigned long long t = 0;
+
+    for (int k = 0; k < n; ++k)
+      if (v[k] != 0) t = add(t, mul(v[k], a[k * n + j]));
+    w[j] = t;
+  }
+}
+
+/*
+** 規則の解析
+**   "記号:後続文字列:重み" または "左文脈<記号>右文脈:後続文字列:重み" の形式の規則 q を
+**   a と w に格納して記号を返す（文脈と重みは省略でき, 重みがなければ w は負の値）
+**   文脈は括弧を含まない記号の並びで, 文脈のある規則の記号には '<' と '>' は使えない
+**   形式が正しくないかパラメータ付きの規則なら -1 を返す
+*/
+int Grammar::parse(const char *q, Alternative &a, double &w)
+{
+  // パラメータ付きの規則は Parametric で扱う
+  if (strchr(q, '(') != 0) return -1;
+
+  const char *colon = strchr(q + 1, ':');
+  if (colon == 0) return -1;
+
+  // 記号の位置 k を探す
+  const int npre = static_cast<int>(colon - q);
+  int k = -1;
+  a.left = a.right = colon;
+  a.nleft = a.nright = 0;
+  if (npre == 1)
+    k = 0;
+  else if (q[1] == '>')
+    k = 0;
+  else {
+    for (int i = 1; i + 1 < npre; ++i) {
+      if (q[i] == '<' && (i + 2 == npre || q[i + 2] == '>')) {
+        k = i + 1;
+        a.left = q;
+        a.nleft = i;
+        break;
+      }
+    }
+    if (k < 0) return -1;
+  }
+  if (k + 2 < npre) {
+    a.right = q + k + 2;
+    a.nright = npre - k - 2;
+  }
+
+  // 後続文字列は次の ':' か終端の手前まで, その後ろに重みが続く
+  const char *e = strchr(colon + 1, ':');
+  a.str = colon + 1;
+  a.length = static_cast<int>(e != 0 ? e - a.str : strlen(a.str));
+  w = e != 0 ? strtod(e + 1, 0) : -1.0;
+
+  return static_cast<unsigned char>(q[k]);
+}
+
+/*
+** コンストラクタ（書き換え規則を記号で引く表にする）
+**   rstr: parse で解析する形式の規則の配列（最後は 0）
+**   文脈のない規則で重みのついたものがある記号は, その記号の文脈のない規則から
+**   重みに比例した確率で選ぶ. 文脈のある規則は文脈のない規則より優先し, 並んだ順に照合する
+*/
+Grammar::Grammar(const char * const *rstr)
+{
+  bool weighted[256];
+  int nrule = 0;
+
+  for (int i = 0; i < 256; ++i) {
+    rule[i] = 0;
+    length[i] = NORULE;
+    first[i] = 0;
+    nalt[i] = 0;
+    ncontext[i] = 0;
+    weighted[i] = false;
+  }
+
+  // 文脈のない規則で重みのついたものがある記号を調べる
+  for (const char * const *q = rstr; *q; ++q, ++nrule) {
+    Alternative a;
+    double w;
+    const int c = parse(*q, a, w);
+
+    if (c >= 0 && a.nleft == 0 && a.nright == 0 && w >= 0.0) weighted[c] = true;
+  }
+
+  // 同じ記号の文脈のない規則が複数あるときは, 重みがなければ最初のものを使い,
+  // 重みがあればすべてを候補にする. その後ろに文脈のある規則をすべて並べる
+  alt = new Alternative[nrule + 1];
+  int nalt_total = 0;
+  random = context = false;
+  for (int c = 0; c < 256; ++c) {
+    first[c] = nalt_total;
+
+    for (int pass = 0; pass < 2; ++pass) {
+      for (const char * const *q = rstr; *q; ++q) {
+        Alternative &a = alt[nalt_total];
+        double w;
+
+        if (parse(*q, a, w) != c) continue;
+
+        if (a.nleft == 0 && a.nright == 0) {
+          if (pass != 0 || (nalt[c] > 0 && !weighted[c])) continue;
+          a.prob = w >= 0.0 ? w : 1.0;
+          ++nalt[c];
+        }
+        else {
+          if (pass != 1) continue;
+          ++ncontext[c];
+        }
+        ++nalt_total;
+      }
+    }
+
+    if (nalt[c] > 0) {
+      rule[c] = alt[first[c]].str;
+      length[c] = alt[first[c]].length;
+    }
+    if (nalt[c] > 1) random = true;
+    if (ncontext[c] > 0) context = true;
+  }
+
+  // 確率的な規則の候補を O(1) で選べるように別名表を作る (Vose の方法)
+  for (int c = 0; c < 256; ++c) {
+    const int n = nalt[c];
+    if (n <= 1) continue;
+
+    Alternative *a = alt + first[c];
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += a[i].prob;
+
+    // 平均が 1 になるように重みを正規化して 1 より小さいものと大きいものに分ける
+    std::vector<int> small, large;
+    for (int i = 0; i < n; ++i) {
+      a[i].prob = sum > 0.0 ? a[i].prob * n / sum : 1.0;
+      a[i].alias = i;
+      (a[i].prob < 1.0 ? small : large).push_back(i);
+    }
+
+    // 小さいものの不足分を大きいものから補う
+    while (!small.empty() && !large.empty()) {
+      const int s = small.back(), l = large.back();
+
+      small.pop_back();
+      a[s].alias = l;
+      a[l].prob -= 1.0 - a[s].prob;
+      if (a[l].prob < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+
+    // 残りは丸め誤差なので必ず自分を選ぶ
+    while (!small.empty()) {
+      a[small.back()].prob = 1.0;
+      small.pop_back();
+    }
+    while (!large.empty()) {
+      a[large.back()].prob = 1.0;
+      large.pop_back();
+    }
+  }
+
+  // 後続文字列の中で [ と ] が対応しているか調べる
+  closed = true;
+  for (int i = 0; i < nalt_total; ++i) {
+    int depth = 0;
+
+    for (const char *p = alt[i].str, *e = p + alt[i].length; p < e && depth >= 0; ++p) {
+      if (*p == '[') ++depth;
+      else if (*p == ']') --depth;
+    }
+    if (depth != 0) closed = false;
+  }
+
+  // 規則に現れる記号を集める
+  nsymbol = 0;
+  for (int i = 0; i < 256; ++i) index[i] = -1;
+  for (int i = 0; i < 256; ++i) {
+    if (nalt[i] + ncontext[i] == 0) continue;
+
+    if (index[i] < 0) {
+      index[i] = nsymbol;
+      symbol[nsymbol++] = static_cast<unsigned char>(i);
+    }
+
+    for (int k = first[i]; k < first[i] + nalt[i] + ncontext[i]; ++k) {
+      for (const char *p = alt[k].str, *e = p + alt[k].length; p < e; ++p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+
+        if (index[c] < 0) {
+          index[c] = nsymbol;
+          symbol[nsymbol++] = c;
+        }
+      }
+    }
+  }
+
+  // 成長行列を作る（規則のない記号はそのまま残るので対角成分を 1 にする）
+  //   確率的な規則や文脈のある規則は候補ごとの記号の数の最大値をとるので上限になる
+  growth = new unsigned long long[nsymbol * nsymbol > 0 ? nsymbol * nsymbol : 1];
+  std::vector<unsigned long long> n(nsymbol > 0 ? nsymbol : 1);
+  for (int i = 0; i < nsymbol; ++i) {
+    unsigned long long *g = growth + i * nsymbol;
+    const int c = symbol[i];
+
+    for (int j = 0; j < nsymbol; ++j) g[j] = 0;
+
+    // 文脈のない規則がなければ書き換えられずに残ることがある
+    if (nalt[c] == 0) g[i] = 1;
+
+    for (int k = first[c]; k < first[c] + nalt[c] + ncontext[c]; ++k) {
+      for (int j = 0; j < nsymbol; ++j) n[j] = 0;
+      for (const char *p = alt[k].str, *e = p + alt[k].length; p < e; ++p)
+        ++n[index[static_cast<unsigned char>(*p)]];
+      for (int j = 0; j < nsymbol; ++j) if (n[j] > g[j]) g[j] = n[j];
+    }
+  }
+}
+
+/*
+** デストラクタ
+*/
+Grammar::~Grammar()
+{
+  delete[] growth;
+  delete[] alt;
+  growth = 0;
+}
+
+/*
+** 文脈を考慮した後続文字列の選択
+**   文字列 s の i 番目の記号に当てはまる文脈のある規則があればその後続文字列を返し,
+**   なければ鍵 key の文字列の j 番目の記号として文脈のない規則から選ぶ
+**   prev と next は neighbor で作った表で, 文脈は括弧で囲まれた枝を飛ばして照合する
+*/
+const char *Grammar::choose(const char *s, int i, const int *prev, const int *next,
+                            unsigned long long key, unsigned long long j, int &n) const
+{
+  const unsigned char c = static_cast<unsigned char>(s[i]);
+
+  for (const Alternative *a = alt + first[c] + nalt[c], *e = a + ncontext[c]; a < e; ++a) {
+    int k = i, m;
+
+    // 左文脈は右から
+    for (m = a->nleft; m > 0 && (k = prev[k]) >= 0 && s[k] == a->left[m - 1]; --m);
+    if (m > 0) continue;
+
+    // 右文脈は左から
+    k = i;
+    for (m = 0; m < a->nright && (k = next[k]) >= 0 && s[k] == a->right[m]; ++m);
+    if (m < a->nright) continue;
+
+    n = a->length;
+    return a->str;
+  }
+
+  return choose(static_cast<char>(c), key, j, n);
+}
+
+/*
+** 前後の記号の位置の表の作成
+**   長さ n の文字列 s の各位置について, 括弧で囲まれた枝を飛ばした前の記号の位置を prev に,
+**   後の記号の位置を next に求める（なければ -1）
+**   枝の最初の記号の前は枝の根元の記号, 枝の最後の記号の後はない
+*/
+void Grammar::neighbor(const char *s, int n, int *prev, int *next)
+{
+  // 括弧の対応を求める（対応するものがなければ -1）
+  std::vector<int> match(n > 0 ? n : 1), open;
+  for (int i = 0; i < n; ++i) {
+    match[i] = -1;
+    if (s[i] == '[')
+      open.push_back(i);
+    else if (s[i] == ']' && !open.empty()) {
+      match[i] = open.back();
+      match[open.back()] = i;
+      open.pop_back();
+    }
+  }
+
+  // 後の記号は後ろから, 枝を飛ばした先の表を引いて求める
+  for (int i = n - 1; i >= 0; --i) {
+    const int j = i + 1;
+
+    if (j == n || s[j] == ']')
+      next[i] = -1;
+    else if (s[j] == '[')
+      next[i] = match[j] >= 0 ? next[match[j]] : -1;
+    else
+      next[i] = j;
+  }
+
+  // 前の記号は前から, 枝を飛ばした先か枝の根元の表を引いて求める
+  for (int i = 0; i < n; ++i) {
+    const int j = i - 1;
+
+    if (j < 0)
+      prev[i] = -1;
+    else if (s[j] == ']')
+      prev[i] = match[j] >= 0 ? prev[match[j]] : -1;
+    else if (s[j] == '[')
+      prev[i] = prev[j];
+    else
+      prev[i] = j;
+  }
+}
+
+/*
+** 文脈を考慮した書き換え
+**   文脈のある規則は書き換える前の文字列全体での前後の記号を見るので,
+**   各再帰レベルの文字列を作り, 括弧を飛ばした前後の記号の位置の表を引きながら書き換える
+**   初期文字列 istr を再帰レベル iter まで書き換えた文字列を s に求める
+**   確率的な規則の鍵は Tree::production と同じく導出の経路から作る
+*/
+void Grammar::rewrite(const char *istr, int iter, unsigned long long seed, std::vector<char> &s) const
+{
+  const bool random = stochastic();
+  std::vector<char> t;
+  std::vector<unsigned long long> key, tkey;            // 各記号がある文字列の鍵
+  std::vector<int> pos, tpos;                           // 各記号のその文字列の中での位置
+  std::vector<int> prev, next;
+
+  s.assign(istr, istr + strlen(istr));
+  if (random) {
+    key.assign(s.size(), seed);
+    for (std::vector<char>::size_type i = 0; i < s.size(); ++i) pos.push_back(static_cast<int>(i));
+  }
+
+  for (int k = 0; k < iter; ++k) {
+    const int n = static_cast<int>(s.size());
+    if (n == 0) break;
+
+    prev.resize(n);
+    next.resize(n);
+    neighbor(&s[0], n, &prev[0], &next[0]);
+
+    t.clear();
+    tkey.clear();
+    tpos.clear();
+    for (int i = 0; i < n; ++i) {
+      const unsigned long long ki = random ? key[i] : 0;
+      const int pi = random ? pos[i] : 0;
+      int m;
+      const char *q = choose(&s[0], i, &prev[0], &next[0], ki, pi, m);
+
+      if (q != 0) {
+        t.insert(t.end(), q, q + m);
+        if (random) {
+          tkey.insert(tkey.end(), m, hash(ki, pi));
+          for (int j = 0; j < m; ++j) tpos.push_back(j);
+        }
+      }
+      else {
+        t.push_back(s[i]);                  // 書き換えない文字はそのまま残す
+        if (random) {
+          tkey.push_back(ki);
+          tpos.push_back(pi);
+        }
+      }
+    }
+
+    s.swap(t);
+    key.swap(tkey);
+    pos.swap(tpos);
+  }
+}
+
+
+/*
+** 記号の数の予測
+**   初期文字列 istr を再帰レベル level まで書き換えたときに現れる記号ごとの数を
+**   成長行列のべき乗から求めて n[256] に格納する（桁あふれするものは ULLONG_MAX）
+**   規則に現れる記号の数を m とすると, ベクトルに行列を level 回掛けると O(m^2 level),
+**   行列を二進法でべき乗すると行列の積が O(m^3) なので O(m^3 log level) になるから,
+**   少ない方を選ぶ（どちらも飽和する演算で同じ結果になる）
+*/
+void Grammar::count(const char *istr, int level, unsigned long long *n) const
+{
+  for (int i = 0; i < 256; ++i) n[i] = 0;
+
+  // 初期文字列の記号の数 v（規則に現れない記号は書き換わらないので直接数える）
+  unsigned long long *v = new unsigned long long[nsymbol * 2 + 1];
+  unsigned long long *w = v + nsymbol;
+  for (int j = 0; j < nsymbol; ++j) v[j] = 0;
+  for (const unsigned char *p = reinterpret_cast<const unsigned char *>(istr); *p; ++p) {
+    if (index[*p] < 0)
+      n[*p] = add(n[*p], 1);
+    else
+      ++v[index[*p]];
+  }
+
+  if (nsymbol > 0) {
+    int bits = 0;
+    for (int k = level; k > 0; k >>= 1) ++bits;
+
+    if (level <= nsymbol * bits) {
+      // v に成長行列を level 回掛ける
+      for (int k = 0; k < level; ++k) {
+        transform(v, growth, w, nsymbol);
+        for (int j = 0; j < nsymbol; ++j) v[j] = w[j];
+      }
+    }
+    else {
+      // v に成長行列の level 乗を二進法で掛ける
+      const int size = nsymbol * nsymbol;
+      unsigned long long *a = new unsigned long long[size * 2];
+      unsigned long long *b = a + size;
+
+      for (int i = 0; i < size; ++i) a[i] = growth[i];
+
+      for (int k = level; k > 0; k >>= 1) {
+        if (k & 1) {
+          transform(v, a, w, nsymbol);
+          for (int j = 0; j < nsymbol; ++j) v[j] = w[j];
+        }
+        if (k > 1) {
+          multiply(a, a, b, nsymbol);
+          for (int i = 0; i < size; ++i) a[i] = b[i];
+        }
+      }
+
+      delete[] a;
+    }
+
+    for (int j = 0; j < nsymbol; ++j) n[symbol[j]] = add(n[symbol[j]], v[j]);
+  }
+
+  delete[] v;
+}
+
+/*
+** 節点を作る記号の並び
+**   前進 (F) と保存位置復帰 (]) だけを見て, 最初と最後の記号（なければ 0）と
+**   間に F を挟まずに ] が続く箇所の数を求める
+*/
+struct Run {
+  char first;                     // 最初の記号
+  char last;                      // 最後の記号
+  unsigned long long empty;       // F を挟まずに ] が続く箇所の数
+};
+
+static void join(Run &r, const Run &s)
+{
+  if (s.first == 0) return;
+  if (r.last == ']' && s.first == ']') r.empty = add(r.empty, 1);
+  r.empty = add(r.empty, s.empty);
+  if (r.first == 0) r.first = s.first;
+  r.last = s.last;
+}
+
+static Run run(const char *s, int n, const Run *u)
+{
+  Run r = { 0, 0, 0 };
+  for (int i = 0; i < n; ++i) join(r, u[static_cast<unsigned char>(s[i])]);
+  return r;
+}
+
+/*
+** 節点がひとつしかない分岐の数
+**   分岐は根元か ] の節点から始まり, 次の ] の手前までの F で節点が増える
+**   記号を展開した中の Run を再帰レベルごとに積み上げて, 最初に F がない根元の分岐と,
+**   F を挟まずに次の ] が続くか最後にある ] の分岐を数える
+*/
+unsigned long long Grammar::single(const char *istr, int level) const
+{
+  if (random || context) return 0;
+
+  std::vector<Run> u(256), t(256);
+  for (int c = 0; c < 256; ++c) {
+    u[c].first = u[c].last = c == 'F' || c == ']' ? static_cast<char>(c) : 0;
+    u[c].empty = 0;
+  }
+
+  for (int k = 0; k < level; ++k) {
+    for (int c = 0; c < 256; ++c) t[c] = length[c] == NORULE ? u[c] : run(rule[c], length[c], &u[0]);
+    u.swap(t);
+  }
+
+  const Run r = run(istr, static_cast<int>(strlen(istr)), &u[0]);
+  return add(add(r.empty, r.first != 'F' ? 1 : 0), r.last == ']' ? 1 : 0);
+}
+
+/*
+** 文字列の入れ子の深さ
+**   各記号を展開した中で [ が入れ子になる深さの最大値 h[256] を使って,
+**   長さ n の文字列 s を展開したときに入れ子になる深さの最大値を求める
+*/
+int Grammar::nest(const char *s, int n, const int *h)
+{
+  int d = 0, m = 0;
+
+  for (int i = 0; i < n; ++i) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+
+    if (d + h[c] > m) m = d + h[c];
+    if (c == '[') ++d;
+    else if (c == ']') --d;
+  }
+
+  return m;
+}
+
+/*
+** 入れ子の深さの予測
+**   初期文字列 istr を再帰レベル level まで書き換えたときに [ が入れ子になる深さを
+**   再帰レベルごとに記号を展開した中の深さを積み上げて求める
+**   （確率的な規則や文脈のある規則は候補の最大値をとるので上限になる）
+*/
+int Grammar::depth(const char *istr, int level) const
+{
+  int h[256], t[256];
+
+  // 書き換えない記号を展開した中の深さ
+  for (int c = 0; c < 256; ++c) h[c] = 0;
+  h['['] = 1;
+
+  for (int k = 0; k < level; ++k) {
+    for (int c = 0; c < 256; ++c) {
+      // 文脈のない規則がなければ書き換えられずに残ることがある
+      t[c] = nalt[c] == 0 ? h[c] : 0;
+
+      for (int i = first[c]; i < first[c] + nalt[c] + ncontext[c]; ++i) {
+        const int m = nest(alt[i].str, alt[i].length, h);
+        if (m > t[c]) t[c] = m;
+      }
+    }
+    for (int c = 0; c < 256; ++c) h[c] = t[c];
+  }
+
+  return nest(istr, static_cast<int>(strlen(istr)), h);
+}
+
+/*
+** 文字列の広がり
+**   各記号を展開した中で根元から届く枝の長さ r[256] と根元から先端までの幹の長さ a[256] を使って,
+**   長さ n の文字列 s を展開したときに根元から届く長さを reach に, 幹の長さを advance に求め,
+**   各記号を展開した中の幹が向きを変えるかどうか t[256] から幹が向きを変えるかどうかを turn に求める
+**   （長さは前進 (F) の数で数え, 括弧の中の枝は入口の位置から数える）
+*/
+void Grammar::span(const char *s, int n, const double *r, const double *a, const bool *t,
+  double &reach, double &advance, bool &turn)
+{
+  std::vector<double> saved;
+  double p = 0.0, m = 0.0;
+  bool b = false;
+
+  for (int i = 0; i < n; ++i) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+
+    if (p + r[c] > m) m = p + r[c];
+    if (saved.empty() && t[c]) b = true;    // 括弧の外の回転は出口の向きを変える
+    if (c == '[') saved.push_back(p);
+    else if (c == ']') {
+      if (!saved.empty()) {
+        p = saved.back();
+        saved.pop_back();
+      }
+    }
+    else
+      p += a[c];
+  }
+
+  reach = m;
+  advance = p;
+  turn = b;
+}
+
+/*
+** 部分木の広がりの予測
+**   記号 c を残りの再帰レベル k で書き換えた部分木の根元から届く長さを r[k * 256 + c] に,
+**   幹の長さを a[k * 256 + c] に, 幹が向きを変えるかどうかを t[k * 256 + c] に,
+**   再帰レベルごとに記号を展開した中の長さを積み上げて求める
+**   （確率的な規則や文脈のある規則は候補の最大値をとるので上限になり, 向きはどれかが変えれば変える）
+*/
+void Grammar::extent(int level, double *r, double *a, bool *t) const
+{
+  // 書き換えない記号を展開した中の長さと向き
+  for (int c = 0; c < 256; ++c) {
+    r[c] = a[c] = c == 'F' ? 1.0 : 0.0;
+    t[c] = c == '+' || c == '-' || c == '>' || c == '<';
+  }
+
+  for (int k = 1; k <= level; ++k) {
+    const double *pr = r + (k - 1) * 256, *pa = a + (k - 1) * 256;
+    const bool *pt = t + (k - 1) * 256;
+    double *tr = r + k * 256, *ta = a + k * 256;
+    bool *tt = t + k * 256;
+
+    for (int c = 0; c < 256; ++c) {
+      // 文脈のない規則がなければ書き換えられずに残ることがある
+      tr[c] = nalt[c] == 0 ? pr[c] : 0.0;
+      ta[c] = nalt[c] == 0 ? pa[c] : 0.0;
+      tt[c] = nalt[c] == 0 ? pt[c] : false;
+
+      for (int i = first[c]; i < first[c] + nalt[c] + ncontext[c]; ++i) {
+        double x, y;
+        bool z;
+        span(alt[i].str, alt[i].length, pr, pa, pt, x, y, z);
+        if (x > tr[c]) tr[c] = x;
+        if (y > ta[c]) ta[c] = y;
+        if (z) tt[c] = true;
+      }
+    }
+  }
+}
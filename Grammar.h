@@ -0,0 +1,125 @@
+/*
+** L-System の生成文法
+*/
+#ifndef GRAMMAR_H
+#define GRAMMAR_H
+
+#include <vector>
+
+class Grammar {
+  const char *rule[256];          // 記号ごとの後続文字列（規則がなければ 0）
+  int length[256];                // 後続文字列の長さ（規則がなければ NORULE）
+  struct Alternative {            // 規則の候補
+    const char *str;              //   後続文字列
+    int length;                   //   後続文字列の長さ
+    double prob;                  //   別名法で自分を選ぶ確率
+    int alias;                    //   別名法で代わりに選ぶ候補
+    const char *left;             //   左文脈
+    int nleft;                    //   左文脈の長さ（文脈がなければ 0）
+    const char *right;            //   右文脈
+    int nright;                   //   右文脈の長さ（文脈がなければ 0）
+  } *alt;                         // すべての記号の候補
+  int first[256];                 // 記号ごとの最初の候補の番号
+  int nalt[256];                  // 記号ごとの文脈のない候補の数（確率的な規則でなければ 1 以下）
+  int ncontext[256];              // 記号ごとの文脈のある候補の数（文脈のない候補の後に並ぶ）
+  bool random;                    // 確率的な規則があれば true
+  bool context;                   // 文脈のある規則があれば true
+  int nsymbol;                    // 規則に現れる記号の数
+  unsigned char symbol[256];      // 規則に現れる記号
+  int index[256];                 // 記号から symbol の添字を引く表（現れなければ -1）
+  unsigned long long *growth;     // 成長行列（記号 i の後続文字列に含まれる記号 j の数）
+  bool closed;                    // すべての後続文字列の括弧が閉じていれば true
+
+  // コピーは禁止
+  Grammar(const Grammar &);
+  Grammar &operator=(const Grammar &);
+
+  static int parse(const char *q, Alternative &a, double &w);
+
+public:
+  enum { NORULE = -1 };           // 規則がないことを表す後続文字列の長さ
+
+  Grammar(const char * const *rstr);
+  virtual ~Grammar();
+
+  // 記号 c の後続文字列（規則がなければ 0, 確率的な規則なら最初の候補, 文脈のある規則は含まない）
+  const char *successor(char c) const { return rule[static_cast<unsigned char>(c)]; };
+
+  // 記号 c の後続文字列の長さ（規則がなければ NORULE, 確率的な規則なら最初の候補）
+  int size(char c) const { return length[static_cast<unsigned char>(c)]; };
+
+  // 導出の経路の鍵 key の文字列の i 番目の記号 c の後続文字列を選び, その長さを n に格納する
+  const char *choose(char c, unsigned long long key, unsigned long long i, int &n) const
+  {
+    const unsigned char u = static_cast<unsigned char>(c);
+
+    if (nalt[u] <= 1) {
+      n = length[u];
+      return rule[u];
+    }
+
+    // 記号の鍵から一様乱数を作り別名法で候補を選ぶ
+    const Alternative *a = alt + first[u];
+    const double x = static_cast<double>(hash(hash(key, i), ~0ULL) >> 11) * (1.0 / 9007199254740992.0) * nalt[u];
+    int k = static_cast<int>(x);
+    if (k >= nalt[u]) k = nalt[u] - 1;
+    if (x - k >= a[k].prob) k = a[k].alias;
+
+    n = a[k].length;
+    return a[k].str;
+  };
+
+  // 導出の経路の鍵 key の文字列の i 番目の記号の鍵（カウンタに基づく乱数）
+  static unsigned long long hash(unsigned long long key, unsigned long long i)
+  {
+    unsigned long long z = key ^ (i + 1) * 0x9e3779b97f4a7c15ULL;
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  };
+
+  // 文字列 s の i 番目の記号の後続文字列を文脈を考慮して選ぶ
+  const char *choose(const char *s, int i, const int *prev, const int *next,
+    unsigned long long key, unsigned long long j, int &n) const;
+
+  // 文字列 s の各位置から括弧で囲まれた枝を飛ばした前後の記号の位置の表を作る
+  static void neighbor(const char *s, int n, int *prev, int *next);
+
+  // 初期文字列 istr を文脈を考慮して再帰レベル level まで書き換えた文字列を s に求める
+  void rewrite(const char *istr, int level, unsigned long long seed, std::vector<char> &s) const;
+
+  // 確率的な規則があれば true
+  bool stochastic() const { return random; };
+
+  // 文脈のある規則があれば true
+  bool sensitive() const { return context; };
+
+  // すべての後続文字列の [ と ] が対応していれば true
+  bool balanced() const { return closed; };
+
+  // 初期文字列 istr を再帰レベル level まで書き換えたときの記号ごとの数を n[256] に求める
+  // （確率的な規則や文脈のある規則があればその上限）
+  void count(const char *istr, int level, unsigned long long *n) const;
+
+  // 初期文字列 istr を再帰レベル level まで書き換えたときに節点がひとつしかない分岐の数
+  // （確率的な規則や文脈のある規則があれば 0 とするので, 節点の多い分岐の数は上限になる）
+  unsigned long long single(const char *istr, int level) const;
+
+  // 初期文字列 istr を再帰レベル level まで書き換えたときの [ の入れ子の深さの上限
+  int depth(const char *istr, int level) const;
+
+  // 記号ごとに展開した中の入れ子の深さ h[256] から長さ n の文字列 s の入れ子の深さを求める
+  static int nest(const char *s, int n, const int *h);
+
+  // 記号を残りの再帰レベル k で書き換えた部分木の根元から届く長さ r と幹の長さ a と
+  // 幹が向きを変えるかどうか t の表を求める（表は (level + 1) * 256 要素, 長さは前進 (F) の数で数え,
+  // 確率的な規則や文脈のある規則は上限で, 候補のどれかが向きを変えれば向きを変えるとする）
+  void extent(int level, double *r, double *a, bool *t) const;
+
+  // 記号ごとに展開した中の長さ r[256], a[256] と向き t[256] から長さ n の文字列 s の広がりを求める
+  static void span(const char *s, int n, const double *r, const double *a, const bool *t,
+    double &reach, double &advance, bool &turn);
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+** 押し出し形状の頂点と指標の配列
+*/
+#include <cstdio>
+#if defined(WIN32)
+//#  pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
+#  pragma comment(lib, "glew32.lib")
+#  undef GL_GLEXT_PROTOTYPES
+#  include "glew.h"
+#  include "glut.h"
+#elif defined(__APPLE__) || defined(MACOSX)
+#  include <GLUT/glut.h>
+#else
+#  define GL_GLEXT_PROTOTYPES
+#  include <GL/glut.h>
+#endif
+#include "Mesh.h"
+
+/*
+** 頂点位置と法線の型に合わせた GL のデータ型
+*/
+static GLenum type(const GLfloat *) { return GL_FLOAT; }
+static GLenum type(const GLdouble *) { return GL_DOUBLE; }
+
+/*
+** 頂点バッファオブジェクトの先頭から n バイト目の位置
+*/
+static const GLvoid *offset(GLsizeiptr n) { return reinterpret_cast<const GLvoid *>(n); }
+
+/*
+** コンストラクタ
+**   配列は allocate で確保する
+*/
+template <typename T>
+Mesh<T>::Mesh()
+  : pv(0), nv(0), nvertex(0), index(0), nindex(0), primitive(0), nprimitive(0)
+  , version(0), vao(0)
+{
+  vbo[0] = vbo[1] = 0;
+}
+
+/*
+** デストラクタ
+*/
+template <typename T>
+Mesh<T>::~Mesh()
+{
+#if defined(GL_VERSION_3_0)
+  if (vao != 0) glDeleteVertexArrays(1, &vao);
+#endif
+  if (vbo[0] != 0) glDeleteBuffers(2, vbo);
+
+  delete[] pv;
+  delete[] nv;
+  delete[] index;
+  delete[] primitive;
+}
+
+/*
+** 配列の確保
+**   頂点数 n, 指標の数 e, 図形の数 m の配列を確保する（次の描画で GPU に送り直す）
+*/
+template <typename T>
+void Mesh<T>::allocate(int n, int e, int m)
+{
+  delete[] pv;
+  delete[] nv;
+  delete[] index;
+  delete[] primitive;
+
+  nvertex = n;
+  pv = new T[n > 0 ? n : 1][3];
+  nv = new T[n > 0 ? n : 1][3];
+  nindex = e;
+  index = new unsigned int[e > 0 ? e : 1];
+  nprimitive = m;
+  primitive = new Primitive[m > 0 ? m : 1];
+  version = 0;
+}
+
+/*
+** GPU への転送
+**   頂点位置と法線をひとつの頂点バッファオブジェクトに, 指標を三角形ストリップと三角形ファンに
+**   分けて図形の区切りを挟んでつないだものを別の頂点バッファオブジェクトに一度だけ送り,
+**   送ったら CPU 側の頂点と指標の配列は捨てる（図形は区切りが使えないときのためにつないだ中の
+**   位置に付け替えて残す）. GL 1.5 に満たなければ送らずに頂点配列で描く
+*/
+template <typename T>
+void Mesh<T>::upload()
+{
+  // GL のバージョンを調べる（描画するコンテキストができてからでないとわからない）
+  int major = 1, minor = 0;
+  const char *string = reinterpret_cast<const char *>(glGetString(GL_VERSION));
+  if (string != 0) sscanf(string, "%d.%d", &major, &minor);
+  version = major * 10 + minor;
+  if (version < 15 || index == 0) return;
+
+  // 三角形ストリップと三角形ファンの順に区切りを挟んで指標をつなぐ
+  unsigned int *joined = new unsigned int[nindex + nprimitive];
+  const unsigned int mode[] = { GL_TRIANGLE_STRIP, GL_TRIANGLE_FAN };
+  int n = 0;
+
+  for (int r = 0; r < 2; ++r) {
+    range[r].mode = mode[r];
+    range[r].first = n;
+
+    for (int k = 0; k < nprimitive; ++k) {
+      Primitive &g = primitive[k];
+      if (g.mode != mode[r]) continue;
+
+      if (n > range[r].first) joined[n++] = RESTART;
+      for (int i = 0; i < g.count; ++i) joined[n + i] = index[g.first + i];
+      g.first = n;
+      n += g.count;
+    }
+
+    range[r].count = n - range[r].first;
+  }
+
+  // 頂点位置と法線を前後に並べて送る
+  const GLsizeiptr size = static_cast<GLsizeiptr>(nvertex) * sizeof *pv;
+  if (vbo[0] == 0) glGenBuffers(2, vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+  glBufferData(GL_ARRAY_BUFFER, size * 2, 0, GL_STATIC_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, pv);
+  glBufferSubData(GL_ARRAY_BUFFER, size, size, nv);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[1]);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(n) * sizeof *joined, joined, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  delete[] joined;
+
+#if defined(GL_VERSION_3_0)
+  // 頂点配列の設定は頂点配列オブジェクトに記録しておく
+  if (version >= 30) {
+    if (vao == 0) glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    bind();
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+#endif
+
+  delete[] pv;
+  pv = 0;
+  delete[] nv;
+  nv = 0;
+  delete[] index;
+  index = 0;
+}
+
+/*
+** 頂点バッファオブジェクトを頂点配列と指標に結びつける
+*/
+template <typename T>
+void Mesh<T>::bind() const
+{
+  const GLenum t = type(static_cast<const T *>(0));
+
+  glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glVertexPointer(3, t, 0, offset(0));
+  glNormalPointer(t, 0, offset(static_cast<GLsizeiptr>(nvertex) * sizeof (T[3])));
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[1]);
+}
+
+/*
+** 描画
+**   GPU に送ってあれば三角形ストリップと三角形ファンをそれぞれ一度に描き,
+**   送れなければ頂点配列を指定して図形ごとに指標で描く
+*/
+template <typename T>
+void Mesh<T>::draw()
+{
+  if (nvertex == 0) return;
+  if (version == 0) upload();
+
+  if (vbo[0] != 0) {
+#if defined(GL_VERSION_3_0)
+    if (vao != 0) glBindVertexArray(vao);
+    else
+#endif
+      bind();
+
+#if defined(GL_VERSION_3_1)
+    if (version >= 31) {
+      // 区切りの指標で図形を分けて種類ごとに一度に描く
+      glEnable(GL_PRIMITIVE_RESTART);
+      glPrimitiveRestartIndex(RESTART);
+      for (int r = 0; r < 2; ++r) {
+        if (range[r].count > 0)
+          glDrawElements(range[r].mode, range[r].count, GL_UNSIGNED_INT,
+                         offset(static_cast<GLsizeiptr>(range[r].first) * sizeof (GLuint)));
+      }
+      glDisable(GL_PRIMITIVE_RESTART);
+    }
+    else
+#endif
+    {
+      for (int k = 0; k < nprimitive; ++k)
+        glDrawElements(primitive[k].mode, primitive[k].count, GL_UNSIGNED_INT,
+                       offset(static_cast<GLsizeiptr>(primitive[k].first) * sizeof (GLuint)));
+    }
+
+#if defined(GL_VERSION_3_0)
+    if (vao != 0) glBindVertexArray(0);
+    else
+#endif
+    {
+      glDisableClientState(GL_NORMAL_ARRAY);
+      glDisableClientState(GL_VERTEX_ARRAY);
+      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+  }
+  else {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, type(*pv), 0, pv);
+    glNormalPointer(type(*nv), 0, nv);
+
+    for (int k = 0; k < nprimitive; ++k)
+      glDrawElements(primitive[k].mode, primitive[k].count, GL_UNSIGNED_INT, index + primitive[k].first);
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+  }
+}
+
+/*
+** 使う頂点位置の型の実体化
+*/
+template class Mesh<float>;
+template class Mesh<double>;
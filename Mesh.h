@@ -0,0 +1,119 @@
+/*
+** 押し出し形状の頂点と指標の配列
+**   頂点位置と法線の型 T は float か double（実体は Mesh.cpp で作る）
+*/
+#ifndef MESH_H
+#define MESH_H
+
+template <typename T>
+class Mesh {
+public:
+  enum { RESTART = 0xffffffff };  // 図形の区切りに使う指標（プリミティブリスタート）
+  struct Primitive {              // 図形
+    unsigned int mode;            //   図形の種類 (GL_TRIANGLE_STRIP か GL_TRIANGLE_FAN)
+    int first;                    //   最初の指標の番号
+    int count;                    //   指標の数
+  };
+  class Part;                     // 確保した配列の一部分への書き込み
+
+private:
+  T (*pv)[3];                     // 頂点位置
+  T (*nv)[3];                     // 法線
+  int nvertex;                    // 頂点数
+  unsigned int *index;            // 指標
+  int nindex;                     // 指標の数
+  Primitive *primitive;           // 図形
+  int nprimitive;                 // 図形の数
+  int version;                    // GL のバージョン（10 * メジャー + マイナー, 調べていなければ 0）
+  unsigned int vbo[2];            // 頂点バッファオブジェクト（頂点位置と法線, 指標）
+  unsigned int vao;               // 頂点配列オブジェクト（使えなければ 0）
+  Primitive range[2];             // 区切りでつないだ三角形ストリップと三角形ファンの指標の範囲
+  void upload();
+  void bind() const;
+
+  // コピーは禁止
+  Mesh(const Mesh &);
+  Mesh &operator=(const Mesh &);
+
+public:
+  Mesh();
+  virtual ~Mesh();
+
+  // 頂点数 n, 指標の数 e, 図形の数 m の配列を確保する（中身は Part で書き込む）
+  void allocate(int n, int e, int m);
+
+  // 頂点数
+  int vertices() const { return nvertex; };
+
+  // 指標の数
+  int size() const { return nindex; };
+
+  void draw();
+};
+
+/*
+** 確保した配列の一部分への書き込み
+**   図形を始めて頂点と指標を追加する手順で, allocate で確保した配列の指定した位置から
+**   書き込む. 書き込む範囲が重ならなければ複数のスレッドで同時に使える
+*/
+template <typename T>
+class Mesh<T>::Part {
+  Mesh &mesh;                     // 書き込み先
+  T current[3];                   // 次の頂点に付ける法線
+  Primitive *open;                // 作成中の図形
+  int vertex;                     // 次に書き込む頂点の番号
+  int index;                      // 次に書き込む指標の番号
+  int primitive;                  // 次に書き込む図形の番号
+
+public:
+  Part(
+    Mesh &mesh,                   // 書き込み先
+    int n = 0,                    // 最初に書き込む頂点の番号
+    int e = 0,                    // 最初に書き込む指標の番号
+    int m = 0                     // 最初に書き込む図形の番号
+    )
+    : mesh(mesh), open(0), vertex(n), index(e), primitive(m)
+  {
+    current[0] = current[1] = 0;
+    current[2] = 1;
+  };
+
+  // 種類 mode の図形を始める
+  void begin(unsigned int mode)
+  {
+    open = mesh.primitive + primitive++;
+    open->mode = mode;
+    open->first = index;
+    open->count = 0;
+  };
+
+  // 次の頂点に付ける法線を指定する
+  void normal(T x, T y, T z) { current[0] = x; current[1] = y; current[2] = z; };
+
+  // 頂点位置 p に法線を付けた頂点を書き込んでその頂点番号を返す
+  unsigned int point(const T *p)
+  {
+    T *q = mesh.pv[vertex], *n = mesh.nv[vertex];
+
+    q[0] = p[0];
+    q[1] = p[1];
+    q[2] = p[2];
+    n[0] = current[0];
+    n[1] = current[1];
+    n[2] = current[2];
+
+    return static_cast<unsigned int>(vertex++);
+  };
+
+  // 頂点番号 i の頂点を作成中の図形に加える
+  void element(unsigned int i)
+  {
+    mesh.index[index++] = i;
+    if (open != 0) ++open->count;
+  };
+
+  // 図形を終える
+  void end() { open = 0; };
+};
+
+#endif
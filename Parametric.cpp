@@ -0,0 +1,222 @@
+/*
+** パラメータ付きの L-System の生成文法
+*/
+#include <cctype>
+#include <cstring>
+#include "Grammar.h"
+#include "Parametric.h"
+
+/*
+** 空白を読み飛ばす
+*/
+static void skip(const char *&s)
+{
+  while (isspace(static_cast<unsigned char>(*s))) ++s;
+}
+
+/*
+** コンストラクタ
+**   initial: 初期文字列（"X(1,2)F" のように実引数は定数式）
+**   rstr: "記号(仮引数,...):条件->後続のモジュール列" の形式の規則の配列（最後は 0）
+**   仮引数と条件は省略できる. "->" のない "記号:後続のモジュール列" は条件のない規則とする
+**   形式が正しくない初期文字列や規則は使わずに errors() に残す
+*/
+Parametric::Parametric(const char *initial, const char * const *rstr)
+  : nreg(1), width(0)
+{
+  if (!modules(initial, axiom)) {
+    bad.push_back(initial);
+    axiom.symbol.clear();
+    axiom.first.assign(1, 0);
+    axiom.out.clear();
+    axiom.body = Program();
+  }
+  if (axiom.body.size() > nreg) nreg = axiom.body.size();
+  width = static_cast<int>(axiom.out.size());
+
+  for (const char * const *q = rstr; *q; ++q) if (!parse(*q)) bad.push_back(*q);
+}
+
+/*
+** パラメータ付きのモジュールがあるか調べる
+*/
+bool Parametric::detect(const char *initial, const char * const *rstr)
+{
+  if (strchr(initial, '(') != 0) return true;
+  for (const char * const *q = rstr; *q; ++q) if (strchr(*q, '(') != 0) return true;
+
+  return false;
+}
+
+/*
+** モジュール列の解析
+**   文字列 s の "記号(式,...)" の並びを m に翻訳する（空白は無視する）
+**   仮引数は m.body を作ったときに指定しておく
+*/
+bool Parametric::modules(const char *s, Successor &m)
+{
+  m.symbol.clear();
+  m.first.assign(1, 0);
+  m.out.clear();
+
+  for (skip(s); *s; skip(s)) {
+    m.symbol += *s++;
+
+    skip(s);
+    if (*s == '(') {
+      ++s;
+      for (;;) {
+        const int r = m.body.compile(s);
+        if (r < 0) return false;
+        m.out.push_back(r);
+
+        skip(s);
+        if (*s == ',') ++s;
+        else if (*s == ')') break;
+        else return false;
+      }
+      ++s;
+    }
+
+    m.first.push_back(static_cast<int>(m.out.size()));
+  }
+
+  return true;
+}
+
+/*
+** 規則の解析
+**   ':' の後は先頭から式を読み, その直後に "->" が続くときだけ条件とする
+**   （後続のモジュール列の中の - と > の並びは矢印ではないので, 式にならなければ
+**     ':' の後をすべて後続のモジュール列とする）
+*/
+bool Parametric::parse(const char *q)
+{
+  const char *s = q;
+  Rule r;
+
+  // 記号と仮引数
+  skip(s);
+  if (*s == '\0') return false;
+  const unsigned char c = static_cast<unsigned char>(*s++);
+  std::vector<std::string> formal;
+  skip(s);
+  if (*s == '(') {
+    for (++s;; ++s) {
+      skip(s);
+      const char *t = s;
+      while (isalnum(static_cast<unsigned char>(*s)) || *s == '_') ++s;
+      if (s == t) return false;
+      formal.push_back(std::string(t, s));
+
+      skip(s);
+      if (*s == ')') break;
+      if (*s != ',') return false;
+    }
+    ++s;
+  }
+  std::vector<const char *> name;
+  for (size_t i = 0; i < formal.size(); ++i) name.push_back(formal[i].c_str());
+  const char *const *np = name.empty() ? 0 : &name[0];
+  r.nformal = static_cast<int>(name.size());
+
+  // 条件と後続のモジュール列
+  skip(s);
+  r.cond = Program(np, r.nformal);
+  r.test = -1;
+  if (*s == ':') {
+    ++s;
+    skip(s);
+    if (s[0] == '-' && s[1] == '>')
+      s += 2;
+    else {
+      Program cond(np, r.nformal);
+      const char *t = s;
+      const int test = cond.compile(t);
+      skip(t);
+      if (test >= 0 && t[0] == '-' && t[1] == '>') {
+        r.cond = cond;
+        r.test = test;
+        s = t + 2;
+      }
+    }
+  }
+  else if (s[0] == '-' && s[1] == '>')
+    s += 2;
+  else
+    return false;
+
+  r.succ.body = Program(np, r.nformal, r.cond.size());
+  if (!modules(s, r.succ)) return false;
+
+  rule[c].push_back(r);
+  if (r.cond.size() > nreg) nreg = r.cond.size();
+  if (r.succ.body.size() > nreg) nreg = r.succ.body.size();
+  if (static_cast<int>(r.succ.out.size()) > width) width = static_cast<int>(r.succ.out.size());
+
+  return true;
+}
+
+/*
+** モジュール列の実引数の計算
+*/
+void Parametric::evaluate(const Successor &m, double *r, double *v) const
+{
+  m.body.run(r);
+  for (size_t i = 0; i < m.out.size(); ++i) v[i] = r[m.out[i]];
+}
+
+/*
+** 規則の適用
+**   記号 c の規則のうち仮引数の数が n で条件が成り立つ最初のものを選び,
+**   仮引数に a[] を入れて後続のモジュール列の実引数の値を v[] に求める
+*/
+const Parametric::Successor *Parametric::apply(char c, const double *a, int n,
+                                               double *r, double *v) const
+{
+  const std::vector<Rule> &list = rule[static_cast<unsigned char>(c)];
+
+  for (std::vector<Rule>::const_iterator p = list.begin(); p != list.end(); ++p) {
+    if (p->nformal != n) continue;
+
+    for (int i = 0; i < n; ++i) r[i] = a[i];
+    if (p->test >= 0) {
+      p->cond.run(r);
+      if (r[p->test] == 0.0) continue;
+    }
+
+    evaluate(p->succ, r, v);
+    return &p->succ;
+  }
+
+  return 0;
+}
+
+/*
+** 入れ子の深さの予測
+**   初期文字列を再帰レベル level まで書き換えたときに [ が入れ子になる深さの上限を
+**   Grammar::depth と同じく再帰レベルごとに積み上げて求める
+**   （条件は調べないので, どの規則も当てはまらずに残る場合も含める）
+*/
+int Parametric::depth(int level) const
+{
+  int h[256], t[256];
+
+  for (int c = 0; c < 256; ++c) h[c] = 0;
+  h['['] = 1;
+
+  for (int k = 0; k < level; ++k) {
+    for (int c = 0; c < 256; ++c) {
+      t[c] = h[c];
+
+      for (std::vector<Rule>::const_iterator p = rule[c].begin(); p != rule[c].end(); ++p) {
+        const std::string &s = p->succ.symbol;
+        const int m = Grammar::nest(s.data(), static_cast<int>(s.size()), h);
+        if (m > t[c]) t[c] = m;
+      }
+    }
+    for (int c = 0; c < 256; ++c) h[c] = t[c];
+  }
+
+  return Grammar::nest(axiom.symbol.data(), static_cast<int>(axiom.symbol.size()), h);
+}
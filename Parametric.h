@@ -0,0 +1,66 @@
+/*
+** パラメータ付きの L-System の生成文法
+*/
+#ifndef PARAMETRIC_H
+#define PARAMETRIC_H
+
+#include <string>
+#include <vector>
+#include "Program.h"
+
+class Parametric {
+public:
+  struct Successor {              // モジュール列
+    std::string symbol;           //   各モジュールの記号
+    std::vector<int> first;       //   各モジュールの実引数の先頭の位置（モジュール数 + 1 要素）
+    std::vector<int> out;         //   各実引数の値を格納するレジスタ
+    Program body;                 //   実引数を計算する命令列
+  };
+
+private:
+  struct Rule {                   // 書き換え規則
+    int nformal;                  //   仮引数の数
+    Program cond;                 //   条件を計算する命令列
+    int test;                     //   条件の値を格納するレジスタ（条件がなければ -1）
+    Successor succ;               //   後続のモジュール列
+  };
+  std::vector<Rule> rule[256];    // 記号ごとの規則（並んだ順に条件を調べる）
+  Successor axiom;                // 初期文字列のモジュール列
+  int nreg;                       // 使うレジスタの数の最大値
+  int width;                      // モジュール列の実引数の数の最大値
+  std::vector<std::string> bad;   // 形式が正しくないので使わなかった初期文字列や規則
+
+  bool parse(const char *q);
+  static bool modules(const char *s, Successor &m);
+
+public:
+  Parametric(const char *initial, const char * const *rstr);
+  virtual ~Parametric() {};
+
+  // 初期文字列か規則にパラメータ付きのモジュールがあれば true
+  static bool detect(const char *initial, const char * const *rstr);
+
+  // 初期文字列のモジュール列
+  const Successor &start() const { return axiom; };
+
+  // モジュール列 m の実引数の値をレジスタ r[] を使って v[] に求める
+  void evaluate(const Successor &m, double *r, double *v) const;
+
+  // 実引数 a[n] の記号 c に当てはまる規則の後続のモジュール列と実引数の値 v[] を求める
+  // （当てはまる規則がなければ 0 を返す）
+  const Successor *apply(char c, const double *a, int n, double *r, double *v) const;
+
+  // 再帰レベル level まで書き換えたときの [ の入れ子の深さの上限
+  int depth(int level) const;
+
+  // 使うレジスタの数
+  int registers() const { return nreg; };
+
+  // モジュール列の実引数の数の最大値
+  int size() const { return width; };
+
+  // 形式が正しくないので使わなかった初期文字列や規則（なければ空）
+  const std::vector<std::string> &errors() const { return bad; };
+};
+
+#endif
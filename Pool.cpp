@@ -0,0 +1,150 @@
+/*
+** ワークスティーリングによるスレッドプール
+*/
+#include "Pool.h"
+
+/*
+** コンストラクタ
+**   n: スレッド数（0 ならハードウェアのスレッド数）
+*/
+Pool::Pool(int n)
+  : next(0), queued(0), pending(0), quit(false)
+{
+  if (n <= 0) n = static_cast<int>(std::thread::hardware_concurrency());
+  if (n <= 0) n = 1;
+
+  nqueue = n;
+  queue = new Queue[nqueue];
+  for (int i = 0; i < nqueue; ++i) worker.push_back(std::thread(&Pool::work, this, i));
+}
+
+/*
+** デストラクタ（残りの仕事を済ませてスレッドを終了する）
+*/
+Pool::~Pool()
+{
+  wait();
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    quit = true;
+  }
+  ready.notify_all();
+
+  for (size_t i = 0; i < worker.size(); ++i) worker[i].join();
+
+  delete[] queue;
+  queue = 0;
+}
+
+/*
+** 仕事を積む（実行し終えた仕事は delete する）
+*/
+void Pool::submit(Task *t)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    ++pending;
+  }
+
+  Queue &q = queue[next];
+  next = (next + 1) % nqueue;
+  {
+    std::lock_guard<std::mutex> guard(q.lock);
+    q.task.push_back(t);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    ++queued;
+  }
+  ready.notify_one();
+}
+
+/*
+** 仕事を取り出す
+**   自分の列の末尾から取り, なければ他の列の先頭から盗む（なければ 0）
+*/
+Pool::Task *Pool::take(int i)
+{
+  for (int k = 0; k < nqueue; ++k) {
+    Queue &q = queue[(i + k) % nqueue];
+    Task *t = 0;
+
+    {
+      std::lock_guard<std::mutex> guard(q.lock);
+      if (!q.task.empty()) {
+        if (k == 0) {
+          t = q.task.back();
+          q.task.pop_back();
+        }
+        else {
+          t = q.task.front();
+          q.task.pop_front();
+        }
+      }
+    }
+
+    if (t != 0) {
+      std::lock_guard<std::mutex> guard(lock);
+      --queued;
+      return t;
+    }
+  }
+
+  return 0;
+}
+
+/*
+** 仕事を実行して後始末する
+*/
+void Pool::finish(Task *t)
+{
+  t->run();
+  delete t;
+
+  bool last;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    last = --pending == 0;
+  }
+  if (last) done.notify_all();
+}
+
+/*
+** スレッドの処理
+*/
+void Pool::work(int i)
+{
+  for (;;) {
+    Task *t = take(i);
+
+    if (t != 0) {
+      finish(t);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    ready.wait(guard, [this] { return queued > 0 || quit; });
+    if (quit && queued == 0) return;
+  }
+}
+
+/*
+** 積んだ仕事がすべて終わるまで待つ（待っている間は呼び出したスレッドも仕事をする）
+*/
+void Pool::wait()
+{
+  for (;;) {
+    Task *t = take(0);
+
+    if (t != 0) {
+      finish(t);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    done.wait(guard, [this] { return pending == 0; });
+    return;
+  }
+}
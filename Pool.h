@@ -0,0 +1,52 @@
+/*
+** ワークスティーリングによるスレッドプール
+*/
+#ifndef POOL_H
+#define POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Pool {
+public:
+  class Task {                    // スレッドで実行する仕事
+  public:
+    virtual ~Task() {};
+    virtual void run() = 0;
+  };
+
+private:
+  struct Queue {                  // スレッドごとの仕事の列
+    std::mutex lock;              //   列の排他制御
+    std::deque<Task *> task;      //   仕事の列（持ち主は末尾から, 他のスレッドは先頭から取る）
+  };
+  std::vector<std::thread> worker;  // 仕事をするスレッド
+  Queue *queue;                   // スレッドごとの仕事の列
+  int nqueue;                     // 仕事の列の数
+  int next;                       // 次に仕事を積む列
+  std::mutex lock;                // 以下の変数の排他制御
+  std::condition_variable ready;  // 仕事が積まれたことの通知
+  std::condition_variable done;   // 仕事が終わったことの通知
+  int queued;                     // 列に積まれている仕事の数
+  int pending;                    // 終わっていない仕事の数
+  bool quit;                      // スレッドを終了するなら true
+  Task *take(int i);
+  void finish(Task *t);
+  void work(int i);
+
+  // コピーは禁止
+  Pool(const Pool &);
+  Pool &operator=(const Pool &);
+
+public:
+  Pool(int n = 0);
+  virtual ~Pool();
+  int size() const { return nqueue; };
+  void submit(Task *t);
+  void wait();
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*
+** コンパイル時に書き換える生成文法
+**   ソースに書いた初期文字列と規則を constexpr で書き換え, タートルが処理する記号だけを
+**   残した命令列と節点の数を静的な表にする. 実行時は Expansion に渡して Tree で再生する
+**   扱えるのは "記号:後続文字列" の形式の規則だけで, 確率的な規則や文脈のある規則,
+**   パラメータ付きの規則は実行時に Grammar で書き換える
+**   （大きな命令列はコンパイラの定数式の評価の上限を上げる必要がある）
+*/
+#ifndef PRESET_H
+#define PRESET_H
+
+#include "Turtle.h"
+
+class Preset {
+public:
+  enum { LIMIT = 64 };            // 書き換えられる再帰レベルの上限（超えると定数式にならない）
+
+  // 文字列 s の長さ
+  static constexpr int length(const char *s)
+  {
+    int n = 0;
+    while (s[n] != '\0') ++n;
+    return n;
+  };
+
+  // 規則 rule がすべて "記号:後続文字列" の形式なら true
+  static constexpr bool plain(const char * const *rule)
+  {
+    for (const char * const *q = rule; *q; ++q) {
+      if ((*q)[0] == '\0' || (*q)[1] != ':') return false;
+      for (const char *p = *q + 2; *p; ++p) if (*p == ':' || *p == '(') return false;
+    }
+    return true;
+  };
+
+  // 記号 c の最初の規則の後続文字列（なければ 0）とその長さ n
+  static constexpr const char *successor(const char * const *rule, char c, int &n)
+  {
+    for (const char * const *q = rule; *q; ++q) {
+      if ((*q)[0] == c) {
+        n = length(*q + 2);
+        return *q + 2;
+      }
+    }
+    n = 0;
+    return 0;
+  };
+
+  // 初期文字列 initial を再帰レベル level まで書き換えたときのタートルの命令の数
+  //   記号ごとに展開した命令の数を再帰レベルごとに積み上げて求める
+  static constexpr unsigned long long count(const char *initial, const char * const *rule, int level)
+  {
+    unsigned long long n[256] = {}, t[256] = {};
+
+    for (int c = 0; c < 256; ++c) n[c] = Turtle::accepts(static_cast<char>(c)) ? 1 : 0;
+
+    for (int k = 0; k < level; ++k) {
+      for (int c = 0; c < 256; ++c) {
+        int m = 0;
+        const char *s = successor(rule, static_cast<char>(c), m);
+
+        t[c] = s != 0 ? 0 : n[c];
+        for (int i = 0; i < m; ++i) t[c] += n[static_cast<unsigned char>(s[i])];
+      }
+      for (int c = 0; c < 256; ++c) n[c] = t[c];
+    }
+
+    unsigned long long total = 0;
+    for (const char *p = initial; *p; ++p) total += n[static_cast<unsigned char>(*p)];
+    return total;
+  };
+
+  // N 個の命令を持つ表（定数式で作る）
+  template <unsigned long long N>
+  class Table {
+    char command[N > 0 ? N : 1];  // タートルが処理する記号だけを残した命令列
+    int nforward;                 // 前進 (F) の数
+    int npop;                     // 保存位置復帰 (]) の数
+    int nest;                     // 現在位置保存 ([) の入れ子の深さの最大値
+
+  public:
+    // 初期文字列 initial を再帰レベル level まで作業スタックで書き換えながら命令を取り出す
+    constexpr Table(const char *initial, const char * const *rule, int level)
+      : command(), nforward(0), npop(0), nest(0)
+    {
+      struct Work {
+        const char *p;              // 次に取り出す文字の位置
+        const char *e;              // 文字列の終端の位置
+        int level;                  // 残りの再帰レベル
+      } work[LIMIT + 1] = {};
+      int top = 0, n = 0, d = 0;
+
+      work[0].p = initial;
+      work[0].e = initial + length(initial);
+      work[0].level = level;
+
+      while (top >= 0) {
+        Work &w = work[top];
+
+        if (w.p == w.e) {
+          --top;
+          continue;
+        }
+
+        const char c = *w.p++;
+        int m = 0;
+        const char *s = w.level > 0 ? successor(rule, c, m) : 0;
+
+        if (s != 0) {
+          Work &u = work[++top];
+          u.p = s;
+          u.e = s + m;
+          u.level = w.level - 1;
+        }
+        else if (Turtle::accepts(c)) {
+          command[n++] = c;
+          if (c == 'F') ++nforward;
+          else if (c == '[') {
+            if (++d > nest) nest = d;
+          }
+          else if (c == ']') {
+            --d;
+            ++npop;
+          }
+        }
+      }
+    };
+
+    // 命令列
+    constexpr const char *data() const { return command; };
+
+    // 命令の数
+    constexpr int size() const { return static_cast<int>(N); };
+
+    // 前進 (F) の数
+    constexpr int forward() const { return nforward; };
+
+    // 保存位置復帰 (]) の数
+    constexpr int pop() const { return npop; };
+
+    // 現在位置保存 ([) の入れ子の深さの最大値
+    constexpr int depth() const { return nest; };
+  };
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*
+** 算術式のバイトコード
+*/
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include "Program.h"
+
+/*
+** 空白を読み飛ばす
+*/
+static void skip(const char *&s)
+{
+  while (isspace(static_cast<unsigned char>(*s))) ++s;
+}
+
+/*
+** 記号を読む（s の先頭が t なら読み進めて true を返す）
+*/
+static bool accept(const char *&s, const char *t)
+{
+  skip(s);
+
+  const size_t n = strlen(t);
+  if (strncmp(s, t, n) != 0) return false;
+
+  s += n;
+  return true;
+}
+
+/*
+** コンストラクタ
+**   name: 仮引数の名前（仮引数 i の値はレジスタ i に置く, 名前は複製して持つ）
+**   nname: 仮引数の数
+**   base: 式の値に使う最初のレジスタ（同じレジスタを使う別のプログラムの後に続けるとき）
+*/
+Program::Program(const char *const *name, int nname, int base)
+  : nreg(base > nname ? base : nname), error(false)
+{
+  for (int i = 0; i < nname; ++i) this->name.push_back(name[i]);
+}
+
+/*
+** 命令を追加して結果を格納するレジスタを返す
+*/
+int Program::emit(Op op, int a, int b)
+{
+  if (nreg >= LIMIT) {
+    error = true;
+    return 0;
+  }
+
+  Code c;
+  c.op = static_cast<unsigned char>(op);
+  c.d = static_cast<unsigned char>(nreg);
+  c.a = static_cast<unsigned char>(a);
+  c.b = static_cast<unsigned char>(b);
+  code.push_back(c);
+
+  return nreg++;
+}
+
+/*
+** 式の値をレジスタに置く
+*/
+int Program::load(const Operand &x)
+{
+  if (!x.constant) return x.reg;
+
+  // 定数の番号は命令語の a と b の 16bit に収める（収まらなければ翻訳のエラー）
+  const int k = static_cast<int>(konst.size());
+  if (k >= KLIMIT) {
+    error = true;
+    return 0;
+  }
+  konst.push_back(x.value);
+  return emit(LOAD, k & 0xff, k >> 8);
+}
+
+/*
+** 二項演算（両方が定数なら翻訳時に計算する）
+*/
+Program::Operand Program::binary(Op op, const Operand &x, const Operand &y)
+{
+  Operand z;
+
+  if (x.constant && y.constant) {
+    const double a = x.value, b = y.value;
+
+    switch (op) {
+    case ADD: z.value = a + b; break;
+    case SUB: z.value = a - b; break;
+    case MUL: z.value = a * b; break;
+    case DIV: z.value = a / b; break;
+    case POW: z.value = pow(a, b); break;
+    case LT:  z.value = a <  b; break;
+    case LE:  z.value = a <= b; break;
+    case GT:  z.value = a >  b; break;
+    case GE:  z.value = a >= b; break;
+    case EQ:  z.value = a == b; break;
+    case NE:  z.value = a != b; break;
+    case AND: z.value = a != 0.0 && b != 0.0; break;
+    case OR:  z.value = a != 0.0 || b != 0.0; break;
+    default:  z.value = 0.0; break;
+    }
+    z.constant = true;
+    z.reg = -1;
+  }
+  else {
+    const int a = load(x), b = load(y);
+
+    z.constant = false;
+    z.value = 0.0;
+    z.reg = emit(op, a, b);
+  }
+
+  return z;
+}
+
+/*
+** 単項演算（定数なら翻訳時に計算する）
+*/
+Program::Operand Program::unary(Op op, const Operand &x)
+{
+  Operand z;
+
+  if (x.constant) {
+    z.constant = true;
+    z.value = op == NEG ? -x.value : x.value == 0.0;
+    z.reg = -1;
+  }
+  else {
+    z.constant = false;
+    z.value = 0.0;
+    z.reg = emit(op, x.reg, x.reg);
+  }
+
+  return z;
+}
+
+/*
+** 一次式（数, 仮引数, 括弧で囲んだ式）
+*/
+bool Program::primary(const char *&s, Operand &x)
+{
+  skip(s);
+
+  if (isdigit(static_cast<unsigned char>(*s)) || *s == '.') {
+    char *e;
+    x.constant = true;
+    x.value = strtod(s, &e);
+    x.reg = -1;
+    if (e == s) return false;
+    s = e;
+    return true;
+  }
+
+  if (isalpha(static_cast<unsigned char>(*s)) || *s == '_') {
+    const char *t = s;
+    while (isalnum(static_cast<unsigned char>(*s)) || *s == '_') ++s;
+
+    const size_t n = s - t;
+    for (size_t i = 0; i < name.size(); ++i) {
+      if (name[i].compare(0, std::string::npos, t, n) == 0) {
+        x.constant = false;
+        x.value = 0.0;
+        x.reg = static_cast<int>(i);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (*s == '(') {
+    ++s;
+    if (!disjunction(s, x)) return false;
+    return accept(s, ")");
+  }
+
+  return false;
+}
+
+/*
+** べき乗（右結合）
+*/
+bool Program::power(const char *&s, Operand &x)
+{
+  if (!primary(s, x)) return false;
+
+  if (accept(s, "^")) {
+    Operand y;
+    if (!sign(s, y)) return false;
+    x = binary(POW, x, y);
+  }
+
+  return true;
+}
+
+/*
+** 符号と否定
+*/
+bool Program::sign(const char *&s, Operand &x)
+{
+  if (accept(s, "-")) {
+    if (!sign(s, x)) return false;
+    x = unary(NEG, x);
+    return true;
+  }
+
+  if (accept(s, "+")) return sign(s, x);
+
+  skip(s);
+  if (*s == '!' && s[1] != '=') {
+    ++s;
+    if (!sign(s, x)) return false;
+    x = unary(NOT, x);
+    return true;
+  }
+
+  return power(s, x);
+}
+
+/*
+** 乗除算
+*/
+bool Program::term(const char *&s, Operand &x)
+{
+  if (!sign(s, x)) return false;
+
+  for (;;) {
+    Op op;
+    if (accept(s, "*")) op = MUL;
+    else if (accept(s, "/")) op = DIV;
+    else return true;
+
+    Operand y;
+    if (!sign(s, y)) return false;
+    x = binary(op, x, y);
+  }
+}
+
+/*
+** 加減算
+*/
+bool Program::sum(const char *&s, Operand &x)
+{
+  if (!term(s, x)) return false;
+
+  for (;;) {
+    Op op;
+    // 条件の後の "->" は減算ではなく規則の矢印なので式をそこで終える
+    skip(s);
+    if (s[0] == '-' && s[1] == '>') return true;
+
+    if (accept(s, "+")) op = ADD;
+    else if (accept(s, "-")) op = SUB;
+    else return true;
+
+    Operand y;
+    if (!term(s, y)) return false;
+    x = binary(op, x, y);
+  }
+}
+
+/*
+** 比較
+*/
+bool Program::compare(const char *&s, Operand &x)
+{
+  if (!sum(s, x)) return false;
+
+  Op op;
+  if (accept(s, "<=")) op = LE;
+  else if (accept(s, ">=")) op = GE;
+  else if (accept(s, "==")) op = EQ;
+  else if (accept(s, "!=")) op = NE;
+  else if (accept(s, "<")) op = LT;
+  else if (accept(s, ">")) op = GT;
+  else return true;
+
+  Operand y;
+  if (!sum(s, y)) return false;
+  x = binary(op, x, y);
+
+  return true;
+}
+
+/*
+** 論理積
+*/
+bool Program::conjunction(const char *&s, Operand &x)
+{
+  if (!compare(s, x)) return false;
+
+  while (accept(s, "&&")) {
+    Operand y;
+    if (!compare(s, y)) return false;
+    x = binary(AND, x, y);
+  }
+
+  return true;
+}
+
+/*
+** 論理和
+*/
+bool Program::disjunction(const char *&s, Operand &x)
+{
+  if (!conjunction(s, x)) return false;
+
+  while (accept(s, "||")) {
+    Operand y;
+    if (!conjunction(s, y)) return false;
+    x = binary(OR, x, y);
+  }
+
+  return true;
+}
+
+/*
+** 式の翻訳
+**   文字列 s の先頭の式を翻訳して s を式の後ろまで進め, 値を格納するレジスタを返す
+**   （構文エラーやレジスタの不足なら -1 を返す）
+*/
+int Program::compile(const char *&s)
+{
+  Operand x;
+
+  if (!disjunction(s, x)) return -1;
+
+  const int r = load(x);
+  return error ? -1 : r;
+}
+
+/*
+** 命令列の実行
+*/
+void Program::run(double *r) const
+{
+  const double *const k = konst.empty() ? 0 : &konst[0];
+
+  for (std::vector<Code>::const_iterator c = code.begin(); c != code.end(); ++c) {
+    if (c->op == LOAD) {
+      r[c->d] = k[c->a | c->b << 8];
+      continue;
+    }
+
+    const double a = r[c->a], b = r[c->b];
+
+    switch (c->op) {
+    case ADD:  r[c->d] = a + b; break;
+    case SUB:  r[c->d] = a - b; break;
+    case MUL:  r[c->d] = a * b; break;
+    case DIV:  r[c->d] = a / b; break;
+    case POW:  r[c->d] = pow(a, b); break;
+    case NEG:  r[c->d] = -a; break;
+    case NOT:  r[c->d] = a == 0.0; break;
+    case LT:   r[c->d] = a <  b; break;
+    case LE:   r[c->d] = a <= b; break;
+    case GT:   r[c->d] = a >  b; break;
+    case GE:   r[c->d] = a >= b; break;
+    case EQ:   r[c->d] = a == b; break;
+    case NE:   r[c->d] = a != b; break;
+    case AND:  r[c->d] = a != 0.0 && b != 0.0; break;
+    case OR:   r[c->d] = a != 0.0 || b != 0.0; break;
+    default:   break;
+    }
+  }
+}
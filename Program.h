@@ -0,0 +1,68 @@
+/*
+** 算術式のバイトコード
+*/
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <string>
+#include <vector>
+
+class Program {
+  enum Op {                       // 命令
+    LOAD,                         //   定数の読み込み
+    ADD, SUB, MUL, DIV, POW,      //   四則演算とべき乗
+    NEG, NOT,                     //   単項演算
+    LT, LE, GT, GE, EQ, NE,       //   比較（真なら 1, 偽なら 0）
+    AND, OR                       //   論理演算
+  };
+  struct Code {                   // 命令語（レジスタ d にレジスタ a と b の演算結果を格納する）
+    unsigned char op;             //   命令
+    unsigned char d;              //   結果を格納するレジスタ
+    unsigned char a;              //   第１オペランドのレジスタ（LOAD なら定数の番号の下位）
+    unsigned char b;              //   第２オペランドのレジスタ（LOAD なら定数の番号の上位）
+  };
+  struct Operand {                // 式の値
+    bool constant;                //   定数なら true
+    double value;                 //   定数の値
+    int reg;                      //   定数でなければ値を格納したレジスタ
+  };
+  std::vector<Code> code;         // 命令列
+  std::vector<double> konst;      // 定数の値
+  int nreg;                       // 使うレジスタの数
+  std::vector<std::string> name;  // 仮引数の名前
+  bool error;                     // 構文エラーがあれば true
+
+  int emit(Op op, int a, int b);
+  int load(const Operand &x);
+  Operand binary(Op op, const Operand &x, const Operand &y);
+  Operand unary(Op op, const Operand &x);
+  bool primary(const char *&s, Operand &x);
+  bool power(const char *&s, Operand &x);
+  bool sign(const char *&s, Operand &x);
+  bool term(const char *&s, Operand &x);
+  bool sum(const char *&s, Operand &x);
+  bool compare(const char *&s, Operand &x);
+  bool conjunction(const char *&s, Operand &x);
+  bool disjunction(const char *&s, Operand &x);
+
+public:
+  enum { LIMIT = 256 };           // レジスタの数の上限
+  enum { KLIMIT = 0x10000 };      // 定数の数の上限（LOAD の命令語の 16bit に収まる数）
+
+  Program(const char *const *name = 0, int nname = 0, int base = 0);
+  virtual ~Program() {};
+
+  // 文字列 s の先頭の式を翻訳して結果を格納するレジスタを返す（エラーなら -1）
+  int compile(const char *&s);
+
+  // レジスタ r[] の上で命令列を実行する（r[0] から順に仮引数の値を入れておく）
+  void run(double *r) const;
+
+  // 使うレジスタの数
+  int size() const { return nreg; };
+
+  // 命令がなければ true
+  bool empty() const { return code.empty(); };
+};
+
+#endif
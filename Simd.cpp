@@ -0,0 +1,453 @@
+/*
+** CPU に合わせて選ぶ SIMD の変換行列の演算
+**   同じ演算を命令セットごとに用意しておき, 起動時に CPUID で調べた CPU が使える
+**   最も幅の広いものを関数ポインタに設定する. x86 以外ではスカラーのものだけを使う
+**   まとめて処理する点列や断面だけを扱い, タートルの１歩ごとの座標系の合成は Frame の
+**   四元数のままスカラーで計算する（４行４列の行列の積の命令列では四元数の積にならず,
+**   １回ごとに関数ポインタを呼ぶと数十回の演算より呼び出しの方が高くつく）
+*/
+#include <cmath>
+#include "Simd.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define SIMD_X86 1
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define SIMD_TARGET(isa)
+#  else
+#    include <cpuid.h>
+#    define SIMD_TARGET(isa) __attribute__((target(isa)))
+#  endif
+#else
+#  define SIMD_X86 0
+#endif
+
+/*
+** スカラー
+*/
+static void transformPointsScalar(const double *m, const double (*v)[3], double (*w)[3], int n)
+{
+  for (int i = 0; i < n; ++i) {
+    const double x = v[i][0], y = v[i][1], z = v[i][2];
+
+    w[i][0] = x * m[ 0] + y * m[ 4] + z * m[ 8] + m[12];
+    w[i][1] = x * m[ 1] + y * m[ 5] + z * m[ 9] + m[13];
+    w[i][2] = x * m[ 2] + y * m[ 6] + z * m[10] + m[14];
+  }
+}
+
+static void transformPointsFloatScalar(const double *m, const float (*v)[3], float (*w)[3], int n)
+{
+  for (int i = 0; i < n; ++i) {
+    const double x = v[i][0], y = v[i][1], z = v[i][2];
+
+    w[i][0] = static_cast<float>(x * m[ 0] + y * m[ 4] + z * m[ 8] + m[12]);
+    w[i][1] = static_cast<float>(x * m[ 1] + y * m[ 5] + z * m[ 9] + m[13]);
+    w[i][2] = static_cast<float>(x * m[ 2] + y * m[ 6] + z * m[10] + m[14]);
+  }
+}
+
+static void transformRingScalar(const double *m, const double *p, const double *x, const double *y,
+  double *u, double *v, double *w, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    u[i] = x[i] * m[0] + y[i] * m[3] + p[0];
+    v[i] = x[i] * m[1] + y[i] * m[4] + p[1];
+    w[i] = x[i] * m[2] + y[i] * m[5] + p[2];
+  }
+}
+
+static void normalizeScalar(double *u, double *v, double *w, int n)
+{
+  for (int i = 0; i < n; ++i) {
+    const double a = sqrt(u[i] * u[i] + v[i] * v[i] + w[i] * w[i]);
+
+    if (a != 0.0) {
+      u[i] /= a;
+      v[i] /= a;
+      w[i] /= a;
+    }
+  }
+}
+
+#if SIMD_X86
+/*
+** SSE2
+**   ベクトルの上半分 (x, y) と下半分 (z, w) を２要素ずつ計算する
+*/
+SIMD_TARGET("sse2")
+static void transformPointsSSE2(const double *m, const double (*v)[3], double (*w)[3], int n)
+{
+  const __m128d c0 = _mm_loadu_pd(m +  0), c1 = _mm_loadu_pd(m +  4);
+  const __m128d c2 = _mm_loadu_pd(m +  8), c3 = _mm_loadu_pd(m + 12);
+  const __m128d d0 = _mm_load_sd(m +  2), d1 = _mm_load_sd(m +  6);
+  const __m128d d2 = _mm_load_sd(m + 10), d3 = _mm_load_sd(m + 14);
+
+  for (int i = 0; i < n; ++i) {
+    const __m128d x = _mm_set1_pd(v[i][0]), y = _mm_set1_pd(v[i][1]), z = _mm_set1_pd(v[i][2]);
+
+    // (x, y) は２要素で, z は下位の１要素で計算する
+    const __m128d xy = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, c0), _mm_mul_pd(y, c1)),
+      _mm_mul_pd(z, c2)), c3);
+    const __m128d zz = _mm_add_sd(_mm_add_sd(_mm_add_sd(_mm_mul_sd(x, d0), _mm_mul_sd(y, d1)),
+      _mm_mul_sd(z, d2)), d3);
+    _mm_storeu_pd(w[i], xy);
+    _mm_store_sd(w[i] + 2, zz);
+  }
+}
+
+SIMD_TARGET("sse2")
+static void transformPointsFloatSSE2(const double *m, const float (*v)[3], float (*w)[3], int n)
+{
+  const __m128d c0 = _mm_loadu_pd(m +  0), c1 = _mm_loadu_pd(m +  4);
+  const __m128d c2 = _mm_loadu_pd(m +  8), c3 = _mm_loadu_pd(m + 12);
+  const __m128d d0 = _mm_load_sd(m +  2), d1 = _mm_load_sd(m +  6);
+  const __m128d d2 = _mm_load_sd(m + 10), d3 = _mm_load_sd(m + 14);
+
+  for (int i = 0; i < n; ++i) {
+    const __m128d x = _mm_set1_pd(v[i][0]), y = _mm_set1_pd(v[i][1]), z = _mm_set1_pd(v[i][2]);
+
+    // 倍精度で計算して (x, y) と z を単精度に直して書き込む
+    const __m128d xy = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, c0), _mm_mul_pd(y, c1)),
+      _mm_mul_pd(z, c2)), c3);
+    const __m128d zz = _mm_add_sd(_mm_add_sd(_mm_add_sd(_mm_mul_sd(x, d0), _mm_mul_sd(y, d1)),
+      _mm_mul_sd(z, d2)), d3);
+    _mm_storel_pi(reinterpret_cast<__m64 *>(w[i]), _mm_cvtpd_ps(xy));
+    _mm_store_ss(w[i] + 2, _mm_cvtpd_ps(zz));
+  }
+}
+
+SIMD_TARGET("sse2")
+static void transformRingSSE2(const double *m, const double *p, const double *x, const double *y,
+  double *u, double *v, double *w, int n)
+{
+  const __m128d mx0 = _mm_set1_pd(m[0]), mx1 = _mm_set1_pd(m[1]), mx2 = _mm_set1_pd(m[2]);
+  const __m128d my0 = _mm_set1_pd(m[3]), my1 = _mm_set1_pd(m[4]), my2 = _mm_set1_pd(m[5]);
+  const __m128d p0 = _mm_set1_pd(p[0]), p1 = _mm_set1_pd(p[1]), p2 = _mm_set1_pd(p[2]);
+  int i = 0;
+
+  // 断面の２頂点ずつ各成分を計算する
+  for (; i + 2 <= n; i += 2) {
+    const __m128d a = _mm_loadu_pd(x + i), b = _mm_loadu_pd(y + i);
+
+    _mm_storeu_pd(u + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a, mx0), _mm_mul_pd(b, my0)), p0));
+    _mm_storeu_pd(v + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a, mx1), _mm_mul_pd(b, my1)), p1));
+    _mm_storeu_pd(w + i, _mm_add_pd(_mm_add_pd(_mm_mul_pd(a, mx2), _mm_mul_pd(b, my2)), p2));
+  }
+
+  if (i < n) transformRingScalar(m, p, x + i, y + i, u + i, v + i, w + i, n - i);
+}
+
+SIMD_TARGET("sse2")
+static void normalizeSSE2(double *u, double *v, double *w, int n)
+{
+  const __m128d zero = _mm_setzero_pd(), one = _mm_set1_pd(1.0);
+  int i = 0;
+
+  for (; i + 2 <= n; i += 2) {
+    const __m128d x = _mm_loadu_pd(u + i), y = _mm_loadu_pd(v + i), z = _mm_loadu_pd(w + i);
+    const __m128d a = _mm_sqrt_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(x, x), _mm_mul_pd(y, y)),
+      _mm_mul_pd(z, z)));
+
+    // 長さが 0 のものは 1 で割る
+    const __m128d k = _mm_cmpneq_pd(a, zero);
+    const __m128d d = _mm_or_pd(_mm_and_pd(k, a), _mm_andnot_pd(k, one));
+    _mm_storeu_pd(u + i, _mm_div_pd(x, d));
+    _mm_storeu_pd(v + i, _mm_div_pd(y, d));
+    _mm_storeu_pd(w + i, _mm_div_pd(z, d));
+  }
+
+  if (i < n) normalizeScalar(u + i, v + i, w + i, n - i);
+}
+
+/*
+** AVX2
+**   ベクトルの４要素をまとめて積和 (FMA) で計算する
+*/
+SIMD_TARGET("avx2,fma")
+static void transformPointsAVX2(const double *m, const double (*v)[3], double (*w)[3], int n)
+{
+  const __m256d c0 = _mm256_loadu_pd(m +  0), c1 = _mm256_loadu_pd(m +  4);
+  const __m256d c2 = _mm256_loadu_pd(m +  8), c3 = _mm256_loadu_pd(m + 12);
+
+  for (int i = 0; i < n; ++i) {
+    __m256d t = _mm256_fmadd_pd(_mm256_broadcast_sd(v[i]), c0, c3);
+    t = _mm256_fmadd_pd(_mm256_broadcast_sd(v[i] + 1), c1, t);
+    t = _mm256_fmadd_pd(_mm256_broadcast_sd(v[i] + 2), c2, t);
+
+    // 第４要素は次の点に重なるので書き込まない
+    _mm_storeu_pd(w[i], _mm256_castpd256_pd128(t));
+    _mm_store_sd(w[i] + 2, _mm256_extractf128_pd(t, 1));
+  }
+}
+
+SIMD_TARGET("avx2,fma")
+static void transformPointsFloatAVX2(const double *m, const float (*v)[3], float (*w)[3], int n)
+{
+  const __m256d c0 = _mm256_loadu_pd(m +  0), c1 = _mm256_loadu_pd(m +  4);
+  const __m256d c2 = _mm256_loadu_pd(m +  8), c3 = _mm256_loadu_pd(m + 12);
+
+  for (int i = 0; i < n; ++i) {
+    __m256d t = _mm256_fmadd_pd(_mm256_set1_pd(v[i][0]), c0, c3);
+    t = _mm256_fmadd_pd(_mm256_set1_pd(v[i][1]), c1, t);
+    t = _mm256_fmadd_pd(_mm256_set1_pd(v[i][2]), c2, t);
+
+    // 単精度に直した第４要素は次の点に重なるので書き込まない
+    const __m128 f = _mm256_cvtpd_ps(t);
+    _mm_storel_pi(reinterpret_cast<__m64 *>(w[i]), f);
+    _mm_store_ss(w[i] + 2, _mm_movehl_ps(f, f));
+  }
+}
+
+SIMD_TARGET("avx2,fma")
+static void transformRingAVX2(const double *m, const double *p, const double *x, const double *y,
+  double *u, double *v, double *w, int n)
+{
+  const __m256d mx0 = _mm256_broadcast_sd(m + 0), mx1 = _mm256_broadcast_sd(m + 1);
+  const __m256d mx2 = _mm256_broadcast_sd(m + 2), my0 = _mm256_broadcast_sd(m + 3);
+  const __m256d my1 = _mm256_broadcast_sd(m + 4), my2 = _mm256_broadcast_sd(m + 5);
+  const __m256d p0 = _mm256_broadcast_sd(p + 0), p1 = _mm256_broadcast_sd(p + 1);
+  const __m256d p2 = _mm256_broadcast_sd(p + 2);
+  int i = 0;
+
+  // 断面の４頂点ずつ各成分を計算する
+  for (; i + 4 <= n; i += 4) {
+    const __m256d a = _mm256_loadu_pd(x + i), b = _mm256_loadu_pd(y + i);
+
+    _mm256_storeu_pd(u + i, _mm256_fmadd_pd(b, my0, _mm256_fmadd_pd(a, mx0, p0)));
+    _mm256_storeu_pd(v + i, _mm256_fmadd_pd(b, my1, _mm256_fmadd_pd(a, mx1, p1)));
+    _mm256_storeu_pd(w + i, _mm256_fmadd_pd(b, my2, _mm256_fmadd_pd(a, mx2, p2)));
+  }
+
+  if (i < n) transformRingSSE2(m, p, x + i, y + i, u + i, v + i, w + i, n - i);
+}
+
+SIMD_TARGET("avx2,fma")
+static void normalizeAVX2(double *u, double *v, double *w, int n)
+{
+  const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    const __m256d x = _mm256_loadu_pd(u + i), y = _mm256_loadu_pd(v + i), z = _mm256_loadu_pd(w + i);
+    const __m256d a = _mm256_sqrt_pd(_mm256_fmadd_pd(z, z, _mm256_fmadd_pd(y, y, _mm256_mul_pd(x, x))));
+
+    // 長さが 0 のものは 1 で割る
+    const __m256d d = _mm256_blendv_pd(one, a, _mm256_cmp_pd(a, zero, _CMP_NEQ_UQ));
+    _mm256_storeu_pd(u + i, _mm256_div_pd(x, d));
+    _mm256_storeu_pd(v + i, _mm256_div_pd(y, d));
+    _mm256_storeu_pd(w + i, _mm256_div_pd(z, d));
+  }
+
+  if (i < n) normalizeSSE2(u + i, v + i, w + i, n - i);
+}
+
+/*
+** AVX-512
+**   512bit のレジスタの上下に２点を入れてまとめて計算する
+*/
+/*
+** ２点の組の変換
+**   レジスタ a, b を続けた 16 要素の o 番目から並ぶ２点を変換して上下に入れる
+*/
+SIMD_TARGET("avx512f")
+static inline __m512d pairAVX512(__m512d a, __m512d b, long long o,
+  __m512d c0, __m512d c1, __m512d c2, __m512d c3)
+{
+  const __m512i ix = _mm512_set_epi64(o + 3, o + 3, o + 3, o + 3, o, o, o, o);
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i iy = _mm512_add_epi64(ix, one);
+  const __m512i iz = _mm512_add_epi64(iy, one);
+
+  __m512d t = _mm512_fmadd_pd(_mm512_permutex2var_pd(a, ix, b), c0, c3);
+  t = _mm512_fmadd_pd(_mm512_permutex2var_pd(a, iy, b), c1, t);
+  return _mm512_fmadd_pd(_mm512_permutex2var_pd(a, iz, b), c2, t);
+}
+
+SIMD_TARGET("avx512f")
+static void transformPointsAVX512(const double *m, const double (*v)[3], double (*w)[3], int n)
+{
+  const __m512d c0 = _mm512_maskz_broadcast_f64x4(0xff, _mm256_loadu_pd(m +  0));
+  const __m512d c1 = _mm512_maskz_broadcast_f64x4(0xff, _mm256_loadu_pd(m +  4));
+  const __m512d c2 = _mm512_maskz_broadcast_f64x4(0xff, _mm256_loadu_pd(m +  8));
+  const __m512d c3 = _mm512_maskz_broadcast_f64x4(0xff, _mm256_loadu_pd(m + 12));
+  const __m512i i0 = _mm512_set_epi64( 9,  8,  6,  5,  4,  2,  1,  0);
+  const __m512i i1 = _mm512_set_epi64(12, 10,  9,  8,  6,  5,  4,  2);
+  const __m512i i2 = _mm512_set_epi64(14, 13, 12, 10,  9,  8,  6,  5);
+  int i = 0;
+
+  // ８点の 24 要素を３つのレジスタに読み, ２点ずつ変換して詰め直してから書き込む
+  // （読み終えてから書くので v と w が同じ領域でもよい）
+  for (; i + 8 <= n; i += 8) {
+    const double *p = v[i];
+    const __m512d l0 = _mm512_loadu_pd(p), l1 = _mm512_loadu_pd(p + 8), l2 = _mm512_loadu_pd(p + 16);
+
+    const __m512d r0 = pairAVX512(l0, l1,  0, c0, c1, c2, c3);
+    const __m512d r1 = pairAVX512(l0, l1,  6, c0, c1, c2, c3);
+    const __m512d r2 = pairAVX512(l1, l2,  4, c0, c1, c2, c3);
+    const __m512d r3 = pairAVX512(l1, l2, 10, c0, c1, c2, c3);
+
+    double *q = w[i];
+    _mm512_storeu_pd(q,      _mm512_permutex2var_pd(r0, i0, r1));
+    _mm512_storeu_pd(q +  8, _mm512_permutex2var_pd(r1, i1, r2));
+    _mm512_storeu_pd(q + 16, _mm512_permutex2var_pd(r2, i2, r3));
+  }
+
+  if (i < n) transformPointsAVX2(m, v + i, w + i, n - i);
+}
+
+SIMD_TARGET("avx512f")
+static void transformRingAVX512(const double *m, const double *p, const double *x, const double *y,
+  double *u, double *v, double *w, int n)
+{
+  const __m512d mx0 = _mm512_set1_pd(m[0]), mx1 = _mm512_set1_pd(m[1]), mx2 = _mm512_set1_pd(m[2]);
+  const __m512d my0 = _mm512_set1_pd(m[3]), my1 = _mm512_set1_pd(m[4]), my2 = _mm512_set1_pd(m[5]);
+  const __m512d p0 = _mm512_set1_pd(p[0]), p1 = _mm512_set1_pd(p[1]), p2 = _mm512_set1_pd(p[2]);
+
+  // 断面の８頂点ずつ各成分を計算し, 端数はマスクで読み書きする
+  for (int i = 0; i < n; i += 8) {
+    const __mmask8 k = static_cast<__mmask8>(n - i >= 8 ? 0xff : (1u << (n - i)) - 1);
+    const __m512d a = _mm512_maskz_loadu_pd(k, x + i), b = _mm512_maskz_loadu_pd(k, y + i);
+
+    _mm512_mask_storeu_pd(u + i, k, _mm512_fmadd_pd(b, my0, _mm512_fmadd_pd(a, mx0, p0)));
+    _mm512_mask_storeu_pd(v + i, k, _mm512_fmadd_pd(b, my1, _mm512_fmadd_pd(a, mx1, p1)));
+    _mm512_mask_storeu_pd(w + i, k, _mm512_fmadd_pd(b, my2, _mm512_fmadd_pd(a, mx2, p2)));
+  }
+}
+
+SIMD_TARGET("avx512f")
+static void normalizeAVX512(double *u, double *v, double *w, int n)
+{
+  const __m512d zero = _mm512_setzero_pd();
+
+  for (int i = 0; i < n; i += 8) {
+    const __mmask8 k = static_cast<__mmask8>(n - i >= 8 ? 0xff : (1u << (n - i)) - 1);
+    const __m512d x = _mm512_maskz_loadu_pd(k, u + i), y = _mm512_maskz_loadu_pd(k, v + i);
+    const __m512d z = _mm512_maskz_loadu_pd(k, w + i);
+    const __m512d a = _mm512_sqrt_pd(_mm512_fmadd_pd(z, z, _mm512_fmadd_pd(y, y, _mm512_mul_pd(x, x))));
+
+    // 長さが 0 でないものだけを割って書き込む
+    const __mmask8 d = _mm512_mask_cmp_pd_mask(k, a, zero, _CMP_NEQ_UQ);
+    _mm512_mask_storeu_pd(u + i, d, _mm512_div_pd(x, a));
+    _mm512_mask_storeu_pd(v + i, d, _mm512_div_pd(y, a));
+    _mm512_mask_storeu_pd(w + i, d, _mm512_div_pd(z, a));
+  }
+}
+
+/*
+** CPUID
+**   機能番号 leaf, 副番号 sub の結果を r[4] (eax, ebx, ecx, edx) に格納する
+*/
+static void cpuid(unsigned int leaf, unsigned int sub, unsigned int *r)
+{
+#  if defined(_MSC_VER)
+  int t[4];
+  __cpuidex(t, static_cast<int>(leaf), static_cast<int>(sub));
+  for (int i = 0; i < 4; ++i) r[i] = static_cast<unsigned int>(t[i]);
+#  else
+  r[0] = r[1] = r[2] = r[3] = 0;
+  __get_cpuid_count(leaf, sub, r, r + 1, r + 2, r + 3);
+#  endif
+}
+
+/*
+** OS が保存するレジスタの状態 (XCR0)
+*/
+static unsigned long long xcr0()
+{
+#  if defined(_MSC_VER)
+  return _xgetbv(0);
+#  else
+  unsigned int lo, hi;
+  __asm__ volatile ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+  return (static_cast<unsigned long long>(hi) << 32) | lo;
+#  endif
+}
+#endif
+
+/*
+** 実行している CPU が使える命令セット
+**   命令セットがあっても OS がそのレジスタを保存しなければ使えない
+*/
+Simd::Level Simd::detect()
+{
+#if SIMD_X86
+  unsigned int r[4];
+
+  cpuid(0, 0, r);
+  const unsigned int nleaf = r[0];
+  if (nleaf < 1) return SCALAR;
+
+  cpuid(1, 0, r);
+  if ((r[3] & (1u << 26)) == 0) return SCALAR;          // SSE2
+
+  // AVX 以上は OSXSAVE と XMM/YMM の保存が必要
+  if ((r[2] & (1u << 27)) == 0 || nleaf < 7) return SSE2;
+  const bool fma = (r[2] & (1u << 12)) != 0;
+  const unsigned long long x = xcr0();
+  if ((x & 0x06) != 0x06) return SSE2;
+
+  cpuid(7, 0, r);
+  if ((r[1] & (1u << 5)) == 0 || !fma) return SSE2;    // AVX2 と FMA
+
+  // AVX-512 はさらに opmask と ZMM の保存が必要
+  if ((r[1] & (1u << 16)) == 0 || (x & 0xe0) != 0xe0) return AVX2;
+  return AVX512;
+#else
+  return SCALAR;
+#endif
+}
+
+/*
+** 使う命令セットの選択
+*/
+Simd::Level Simd::select(Level l)
+{
+  const Level available = detect();
+  if (l > available) l = available;
+
+  transformPoints = transformPointsScalar;
+  transformPointsFloat = transformPointsFloatScalar;
+  transformRing = transformRingScalar;
+  normalize = normalizeScalar;
+
+#if SIMD_X86
+  switch (l) {
+  case AVX512:
+    transformPoints = transformPointsAVX512;
+    transformPointsFloat = transformPointsFloatAVX2;          // 単精度の点は 256bit で足りる
+    transformRing = transformRingAVX512;
+    normalize = normalizeAVX512;
+    break;
+  case AVX2:
+    transformPoints = transformPointsAVX2;
+    transformPointsFloat = transformPointsFloatAVX2;
+    transformRing = transformRingAVX2;
+    normalize = normalizeAVX2;
+    break;
+  case SSE2:
+    transformPoints = transformPointsSSE2;
+    transformPointsFloat = transformPointsFloatSSE2;
+    transformRing = transformRingSSE2;
+    normalize = normalizeSSE2;
+    break;
+  default:
+    break;
+  }
+#endif
+
+  return level = l;
+}
+
+/*
+** 関数ポインタ（起動時に CPU が使える最も幅の広い命令セットのものを選ぶ）
+*/
+void (*Simd::transformPoints)(const double *m, const double (*v)[3], double (*w)[3], int n)
+  = transformPointsScalar;
+void (*Simd::transformPointsFloat)(const double *m, const float (*v)[3], float (*w)[3], int n)
+  = transformPointsFloatScalar;
+void (*Simd::transformRing)(const double *m, const double *p, const double *x, const double *y,
+  double *u, double *v, double *w, int n) = transformRingScalar;
+void (*Simd::normalize)(double *u, double *v, double *w, int n) = normalizeScalar;
+Simd::Level Simd::level = Simd::select(Simd::detect());
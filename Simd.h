@@ -0,0 +1,46 @@
+/*
+** CPU に合わせて選ぶ SIMD の変換行列の演算
+*/
+#ifndef SIMD_H
+#define SIMD_H
+
+class Simd {
+public:
+  enum Level {                    // 使う命令セット
+    SCALAR,                       //   SIMD 命令を使わない
+    SSE2,                         //   SSE2 (128bit)
+    AVX2,                         //   AVX2 と FMA (256bit)
+    AVX512                        //   AVX-512F (512bit)
+  };
+
+  // n 個の位置 v (w = 1) にアフィン変換の行列 m をかけた結果を w に格納する
+  static void (*transformPoints)(const double *m, const double (*v)[3], double (*w)[3], int n);
+
+  // n 個の単精度の位置 v (w = 1) にアフィン変換の行列 m をかけた結果を w に格納する（計算は倍精度）
+  static void (*transformPointsFloat)(const double *m, const float (*v)[3], float (*w)[3], int n);
+
+  // 断面の n 個の頂点 (x, y) を３行３列の行列 m の上２行で回転して p に平行移動した結果を
+  // (u, v, w) に格納する（u = x m[0] + y m[3] + p[0] など, 座標値はすべて成分ごとの配列）
+  static void (*transformRing)(const double *m, const double *p, const double *x, const double *y,
+    double *u, double *v, double *w, int n);
+
+  // 成分ごとの配列 (u, v, w) に入れた n 個のベクトルを正規化する（長さが 0 のものはそのまま）
+  static void (*normalize)(double *u, double *v, double *w, int n);
+
+  // 実行している CPU が使える命令セット
+  static Level detect();
+
+  // 使う命令セットを level にする（CPU が使えなければ使えるものまで下げる）
+  static Level select(Level level);
+
+  // 使っている命令セット
+  static Level current() { return level; };
+
+private:
+  static Level level;             // 使っている命令セット
+
+  // インスタンスは作らない
+  Simd();
+};
+
+#endif
@@ -0,0 +1,52 @@
+/*
+** 生成文法で書き換えた命令列の逐次読み出し
+*/
+#include <cstring>
+#include "Stream.h"
+
+/*
+** コンストラクタ（作業スタックの底に初期文字列を置く）
+*/
+Stream::Stream(const Grammar &g, const char *initial, int level, unsigned long long seed)
+  : grammar(g), work(level + 1), depth(0)
+{
+  Frame &w = work[0];
+
+  w.p = w.s = initial;
+  w.e = initial + strlen(initial);
+  w.key = seed;
+  w.level = level;
+}
+
+/*
+** 次の命令
+**   Tree::production と同じ手順で書き換え, タートルに渡す文字が出てきたところで返す
+*/
+char Stream::next()
+{
+  while (depth >= 0) {
+    Frame &w = work[depth];
+
+    if (w.p == w.e) {                       // この文字列を処理し終えたら
+      --depth;                              // ひとつ上の文字列に戻る
+      continue;
+    }
+
+    const char c = *w.p++;
+    const unsigned long long i = w.p - 1 - w.s;
+    const char *q;
+    int n;
+
+    if (w.level > 0 && (q = grammar.choose(c, w.key, i, n)) != 0) {
+      Frame &u = work[++depth];             // 規則があればその後続文字列を積む
+      u.p = u.s = q;
+      u.e = q + n;
+      u.key = Grammar::hash(w.key, i);
+      u.level = w.level - 1;
+    }
+    else
+      return c;                             // 書き換えない文字を返す
+  }
+
+  return '\0';
+}
@@ -0,0 +1,45 @@
+/*
+** 生成文法で書き換えた命令列の逐次読み出し
+*/
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <vector>
+#include "Grammar.h"
+
+/*
+** タートルの命令列
+**   初期文字列を書き換えた文字列を, 書き換えの作業スタックだけを使って先頭から一文字ずつ取り出す
+**   使うメモリは再帰レベルの深さに比例し, 書き換えた文字列の長さによらない
+**   文脈のある規則とパラメータ付きの規則は扱わない
+*/
+class Stream {
+  struct Frame {                  // 書き換えの作業スタックの要素
+    const char *p;                //   次に取り出す文字の位置
+    const char *e;                //   文字列の終端の位置
+    const char *s;                //   文字列の先頭の位置
+    unsigned long long key;       //   文字列を導出した経路の鍵
+    int level;                    //   残りの再帰レベル
+  };
+  const Grammar &grammar;         // 生成文法
+  std::vector<Frame> work;        // 書き換えの作業スタック
+  int depth;                      // 作業スタックの先頭の要素の番号（空なら -1）
+
+  // コピーは禁止
+  Stream(const Stream &);
+  Stream &operator=(const Stream &);
+
+public:
+  Stream(
+    const Grammar &g,             // 生成文法
+    const char *initial,          // 初期文字列
+    int level,                    // 再帰レベル
+    unsigned long long seed = 0   // 確率的な規則の乱数の種
+    );
+  virtual ~Stream() {};
+
+  // 次の命令（終わりなら '\0'）
+  char next();
+};
+
+#endif
@@ -1,224 +1,833 @@
-/*
-** L-System ɂ؂̐
-*/
-#include <cmath>
-#if defined(WIN32)
-//#  pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
-#  undef GL_GLEXT_PROTOTYPES
-#  include "glut.h"
-#elif defined(__APPLE__) || defined(MACOSX)
-#  include <GLUT/glut.h>
-#else
-#  include <GL/glut.h>
-#endif
-#include "extrusion.h"
-#include "Matrix.h"
-#include "Tree.h"
-
-/*
-** ~ M_PI  Visual Studio  cmath ł͒`ĂȂ
-*/
-#ifndef M_PI
-#  define M_PI 3.14159265358979323846
-#endif
-
-/*
-** ̎}̍̈ʒui_j
-*/
-const double Tree::base[] = { 0.0, 0.0, 0.0, 1.0 };
-
-/*
-** ^[g̏
-*/
-void Tree::turtle(const char *p)
-{
-  for (; *p != '\0'; ++p) {
- 
-    switch (*p){
-
-    case 'F': // Oi
-      m.translate(top);
-      m.projection(base, spine[nspine++]);
-      break;
-      
-    case '+': // E]
-      m.rotate( rotate, top);
-      break;
-    case '-': // ]
-      m.rotate(-rotate, top);
-      break;
-      
-    case '>': // E
-      m.rotate( bend, 0.0, 0.0, 1.0);
-      break;
-    case '<': // 
-      m.rotate(-bend, 0.0, 0.0, 1.0);
-      break;
-      
-    case '[': // ݈ʒuۑ
-      m.push();
-      break;
-    case ']': // ۑʒuA
-      m.pop();
-      m.projection(base, spine[branch[nbranch++] = nspine++]);
-      break;
-      
-    default:
-      break;
-    }
-  }
-}
-
-/*
-** ߓ_̃JEg
-*/
-void Tree::count(const char *p)
-{
-  for (; *p != '\0'; ++p) {
-    switch (*p){
-    case ']': // ۑʒuA
-      ++nbranch;
-    case 'F': // Oi
-      ++nspine;
-    default:
-      break;
-    }
-  }
-}
-
-/*
-** @̏
-*/
-void Tree::production(const char *istr, const char * const *rstr, int iter)
-{
-  if (--iter >= 0) {
-    for (const char *p = istr; *p; ++p) {   // 񂩂Po
-      const char * const *q;
-
-      for (q = rstr; *q; ++q) {             // KЂƂo
-        if (*p == **q) {                    // ̕ƋK̂Pڂr
-          production(*q + 2, rstr, iter);   // v珉̋Kŏ
-          break;
-        }
-      }
-      
-      if (*q == 0) {                        // vKȂ
-        const char r[2] = { *p, 0 };        // ̏̕s
-
-        if (flag)
-          count(r);
-        else
-          turtle(r);
-      }
-    }
-  }
-  else {
-    if (flag)
-      count(istr);
-    else
-      turtle(istr);
-  }
-}
-
-/*
-** RXgN^i؂̐j
-*/
-Tree::Tree(
-           const char *initial,       // 
-           const char * const *rule,  // K
-           int level,                 // ċAx
-           const double *direction,   // ؂Lт
-           double rstep,              // S̉]̊pxXebv
-           double bstep,              // Ȃ̊pxXebv
-           double r,                  // ؂̍̔a
-           int n                      // ؂̑ʐ
-           )
-{
-  // |C^̏
-  spine = 0;
-  branch = 0;
-  cs = 0;
-
-  // ؂Lт
-  if (direction != 0) {
-    top[0] = direction[0];
-    top[1] = direction[1];
-    top[2] = direction[2];
-  }
-  else {
-    top[0] = 0.0;
-    top[1] = 1.0;
-    top[2] = 0.0;
-  }
-  top[3] = 1.0;
-
-  // S̉]̊pxXebv
-  rotate = rstep * M_PI / 180.0;
-
-  // Ȃ̊pxXebv
-  bend = bstep * M_PI / 180.0;
-
-  // ̔a
-  radius = r;
-
-  // fʌ`𐶐
-  ncs = (n <= EXTRUSION_CS_LIMIT) ? n : EXTRUSION_CS_LIMIT;
-  cs = new double[ncs][2];
-  for (int i = 0; i < ncs; ++i) {
-    double t = 2.0 * M_PI * (double)i / (double)ncs;
-    
-    cs[i][0] = radius * cos(t);
-    cs[i][1] = radius * sin(t);
-  }
-  
-  // Kvȃmۂ
-  flag = nspine = nbranch = 1;
-  production(initial, rule, level);
-  spine = new double[nspine][3];
-  branch = new int[nbranch];
-
-  // ŏ̐ߓ_ɖ؂̍̈ʒuݒ肷
-  flag = nspine = nbranch = 0;
-  spine[nspine][0] = base[0] / base[3];
-  spine[nspine][1] = base[1] / base[3];
-  spine[nspine][2] = base[2] / base[3];
-  nspine++;
-
-  // ؂𐶐
-  production(initial, rule, level);
-
-  // Ō̕ɍŌ̐ߓ_ԍo^
-  branch[nbranch++] = nspine;
-}
-
-/*
-** fXgN^ij
-*/
-Tree::~Tree()
-{
-  delete[] spine;
-  spine = 0;
-  
-  delete[] branch;
-  branch = 0;
-  
-  delete[] cs;
-  cs = 0;
-}
-
-/*
-** ؂̕`
-*/
-void Tree::draw()
-{
-  for (int i = 0, j = 0; i < nbranch; ++i) {
-#if 1
-    extrusion(cs, ncs, spine + j, branch[i] - j);
-    j = branch[i];
-#else
-    glBegin(GL_LINE_STRIP);
-    while (j < branch[i]) glVertex4dv(spine[j++]);
-    glEnd();
-#endif
-  }
-}
+/*
+** L-System による木の生成
+*/
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#if defined(WIN32)
+//#  pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
+#  undef GL_GLEXT_PROTOTYPES
+#  include "glut.h"
+#elif defined(__APPLE__) || defined(MACOSX)
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+#include "extrusion.h"
+#include "Frame.h"
+#include "Pool.h"
+#include "Tree.h"
+
+/*
+** 円周率 M_PI は Visual Studio の cmath では定義されていない
+*/
+#ifndef M_PI
+#  define M_PI 3.14159265358979323846
+#endif
+
+/*
+** 書き換えた後の座標系が使われないかどうか
+**   作業スタック w～bottom で次に処理する記号が ] か, どの文字列も終わっていれば true を返す
+*/
+bool Tree::tail(const Work *w, const Work *bottom)
+{
+  for (; w >= bottom; --w) if (w->p != w->e) return *w->p == ']';
+  return true;
+}
+
+/*
+** 生成文法の処理
+**   再帰呼び出しの代わりに（文字列の位置, 残りの再帰レベル）を作業スタック w に積み,
+**   作業スタックの底 w[0] に置いた文字列を書き換えた文字を直接タートル t に渡す
+**   確率的な規則は導出の経路から作った鍵で選ぶので, どこから処理しても同じ結果になる
+*/
+void Tree::production(Turtle &t, Work *w) const
+{
+  Work *const bottom = w;
+
+  while (w >= bottom) {
+    if (w->p == w->e) {                     // この文字列を処理し終えたら
+      --w;                                  // ひとつ上の文字列に戻る
+      continue;
+    }
+
+    const char c = *w->p++;
+    const char *q;
+    int n;
+
+    if (w->level > 0 && (q = grammar.choose(c, w->key, w->p - 1 - w->s, n)) != 0) {
+      // 小さすぎる部分木は書き換えない
+      if (reach != 0 && coarse(t, c, w->level, tail(w, bottom))) continue;
+      ++w;                                  // 規則があればその後続文字列を積む
+      w->p = w->s = q;
+      w->e = q + n;
+      w->key = Grammar::hash(w[-1].key, w[-1].p - 1 - w[-1].s);
+      w->level = w[-1].level - 1;
+    }
+    else
+      t.move(c);                            // 書き換えない文字はそのまま処理する
+  }
+}
+
+/*
+** 詳細度による書き換えの打ち切り
+**   記号 c を残りの再帰レベル iter で書き換えた部分木の根元から届く長さが打ち切る大きさ
+**   （視点があれば視点からの距離との比）より小さければ, 書き換える代わりに部分木の幹の長さの
+**   １本の枝をタートル t に渡して true を返す（枝を含まない部分木は向きを変えるので打ち切らない）
+**   １本の枝は出口の向きを変えないので, 幹が向きを変える部分木は後に続く記号がなく
+**   書き換えた後の座標系が使われないとき (last が true) だけ打ち切る
+*/
+bool Tree::coarse(Turtle &t, char c, int iter, bool last) const
+{
+  const int i = iter * 256 + static_cast<unsigned char>(c);
+  double d = 1.0;
+
+  if (reach[i] <= 0.0 || (turn[i] && !last)) return false;
+
+  if (view) {
+    const double *o = t.frame().position();
+    const double x = o[0] - eye[0], y = o[1] - eye[1], z = o[2] - eye[2];
+    d = sqrt(x * x + y * y + z * z);
+  }
+  if (reach[i] >= limit * d) return false;
+
+  if (advance[i] > 0.0) t.move('F', advance + i, 1);
+  return true;
+}
+
+/*
+** スレッドで生成した骨格と分岐
+*/
+struct Tree::Segment {
+  int at;                         // 呼び出し側が生成した骨格の頂点のうちこの前にあるものの数
+  int bat;                        // 呼び出し側が生成した分岐のうちこの前にあるものの数
+  Scalar (*spine)[3];             // 骨格の頂点位置
+  int nspine;                     // 骨格の頂点数
+  int *branch;                    // 分岐位置の頂点番号（この中での番号）
+  int nbranch;                    // 分岐の数
+};
+
+/*
+** スレッドで生成する分岐の括弧の中
+*/
+struct Tree::Block : public Pool::Task {
+  const Tree *tree;               // 生成する木
+  Turtle turtle;                  // 入口の状態のタートル
+  Work frame;                     // 括弧の中の文字列
+  Segment *segment;               // 生成した骨格と分岐の格納先
+
+  Block(const Tree *tree, const Turtle &turtle, const Work &frame, Segment *segment)
+    : tree(tree), turtle(turtle), frame(frame), segment(segment) {};
+
+  // 括弧の中を逐次処理と同じ手順で生成する
+  void run()
+  {
+    Buffer<Scalar[3]> sp;
+    Buffer<int> bp;
+    turtle.output(&sp, &bp);
+
+    Work *w = new Work[frame.level + 1];
+    w[0] = frame;
+    tree->production(turtle, w);
+    delete[] w;
+
+    segment->nspine = sp.size();
+    segment->spine = sp.adopt();
+    segment->nbranch = bp.size();
+    segment->branch = bp.adopt();
+  };
+};
+
+/*
+** 複数のスレッドによる生成文法の処理
+**   分岐の括弧 [ ] の中は入口の座標系がわかれば独立に生成できるので,
+**   ほどよい大きさの括弧の中を仕事としてスレッドプールに渡し,
+**   それぞれが生成したものを逐次処理と同じ順序になるように最後につなぎ合わせる
+**   （確率的な規則では括弧の中の大きさは最初の候補で見積もる）
+*/
+void Tree::parallel(const char *istr, int iter, Buffer<Scalar[3]> &sp, Buffer<int> &bp,
+                    unsigned long long seed)
+{
+  Pool pool;
+
+  // 記号を各再帰レベルで処理したときに増える骨格の頂点 ns と分岐 nb の数
+  const int size = (iter + 1) * 256;
+  unsigned long long *ns = new unsigned long long[size * 2];
+  unsigned long long *nb = ns + size;
+
+  for (int c = 0; c < 256; ++c) {
+    ns[c] = c == 'F' || c == ']';
+    nb[c] = c == ']';
+  }
+  for (int k = 1; k <= iter; ++k) {
+    for (int c = 0; c < 256; ++c) {
+      const char *q = grammar.successor(static_cast<char>(c));
+
+      if (q != 0) {
+        ns[k * 256 + c] = nb[k * 256 + c] = 0;
+        for (const char *e = q + grammar.size(static_cast<char>(c)); q < e; ++q) {
+          ns[k * 256 + c] += ns[(k - 1) * 256 + static_cast<unsigned char>(*q)];
+          nb[k * 256 + c] += nb[(k - 1) * 256 + static_cast<unsigned char>(*q)];
+        }
+      }
+      else {
+        ns[k * 256 + c] = ns[c];
+        nb[k * 256 + c] = nb[c];
+      }
+    }
+  }
+
+  // 仕事の大きさの上限（スレッドあたり 16 個程度に分ける）と下限
+  unsigned long long total = 0;
+  for (const char *p = istr; *p; ++p) total += ns[iter * 256 + static_cast<unsigned char>(*p)];
+  unsigned long long grain = total / (pool.size() * 16);
+  if (grain < 1024) grain = 1024;
+  const unsigned long long least = 64;
+
+  // 括弧の外はここで生成する
+  Buffer<Scalar[3]> lsp;
+  Buffer<int> lbp;
+  turtle.output(&lsp, &lbp);
+  std::vector<Segment *> segment;
+
+  // 作業スタックの底に初期文字列を置く
+  Work *w = work;
+  w->p = w->s = istr;
+  w->e = istr + strlen(istr);
+  w->key = seed;
+  w->level = iter;
+
+  while (w >= work) {
+    if (w->p == w->e) {
+      --w;
+      continue;
+    }
+
+    const char c = *w->p++;
+    const char *q;
+    int n;
+
+    if (w->level > 0 && (q = grammar.choose(c, w->key, w->p - 1 - w->s, n)) != 0) {
+      if (reach != 0 && coarse(turtle, c, w->level, tail(w, work))) continue;
+      ++w;
+      w->p = w->s = q;
+      w->e = q + n;
+      w->key = Grammar::hash(w[-1].key, w[-1].p - 1 - w[-1].s);
+      w->level = w[-1].level - 1;
+      continue;
+    }
+
+    if (c == '[') {
+      // 同じ文字列の中で対応する ] を探して括弧の中の大きさを求める
+      const unsigned long long *s = ns + w->level * 256;
+      unsigned long long m = 0;
+      int depth = 1;
+
+      for (q = w->p; q < w->e; ++q) {
+        if (*q == '[') ++depth;
+        else if (*q == ']' && --depth == 0) break;
+        m += s[static_cast<unsigned char>(*q)];
+      }
+
+      // 大きすぎる括弧の中はさらに分けるため, 小さすぎるものは手間を省くためにここで処理する
+      if (q < w->e && m >= least && m <= grain) {
+        turtle.move('[');
+
+        Segment *g = new Segment;
+        g->at = lsp.size();
+        g->bat = lbp.size();
+        segment.push_back(g);
+
+        Work frame = *w;
+        frame.e = q;
+        pool.submit(new Block(this, turtle, frame, g));
+
+        // 括弧の中を飛ばして次は ] を処理する
+        w->p = q;
+        continue;
+      }
+    }
+
+    turtle.move(c);
+  }
+
+  pool.wait();
+  delete[] ns;
+
+  // 括弧の外と中を生成した順につなぎ合わせる
+  const int nspine = lsp.size(), nbranch = lbp.size();
+  Scalar (*spine)[3] = lsp.adopt();
+  int *branch = lbp.adopt();
+  int at = 0, bat = 0, shift = sp.size();
+
+  for (std::vector<Segment *>::size_type k = 0; k <= segment.size(); ++k) {
+    Segment *g = k < segment.size() ? segment[k] : 0;
+    const int end = g != 0 ? g->at : nspine, bend = g != 0 ? g->bat : nbranch;
+
+    // 括弧の外の頂点番号はそれまでに挟んだ括弧の中の頂点数だけずらす
+    for (; bat < bend; ++bat) bp.push() = branch[bat] + shift;
+    if (end > at) memcpy(sp.push(end - at), spine + at, (end - at) * sizeof *spine);
+    at = end;
+
+    if (g != 0) {
+      const int start = sp.size();
+
+      for (int i = 0; i < g->nbranch; ++i) bp.push() = g->branch[i] + start;
+      if (g->nspine > 0) memcpy(sp.push(g->nspine), g->spine, g->nspine * sizeof *g->spine);
+      shift += g->nspine;
+
+      delete[] g->spine;
+      delete[] g->branch;
+      delete g;
+    }
+  }
+
+  delete[] spine;
+  delete[] branch;
+  turtle.output(&sp, &bp);
+}
+
+/*
+** パラメータ付きの生成文法の処理
+**   production と同じく作業スタックで書き換えながら直接タートルに渡す
+**   後続のモジュール列の実引数は再帰レベルごとに用意した配列にまとめて計算する
+*/
+void Tree::expand(const Parametric &g, int iter)
+{
+  struct Frame {                  // 書き換えの作業スタックの要素
+    const Parametric::Successor *m;  //   モジュール列
+    int i;                        //   次に取り出すモジュールの番号
+    int level;                    //   残りの再帰レベル
+    double *v;                    //   モジュール列の実引数の値
+  };
+  const int width = g.size() > 0 ? g.size() : 1;
+  std::vector<Frame> f(iter + 1);
+  std::vector<double> value((iter + 1) * width);
+  std::vector<double> r(g.registers() > 0 ? g.registers() : 1);
+
+  for (int k = 0; k <= iter; ++k) f[k].v = &value[k * width];
+
+  // 作業スタックの底に初期文字列を置く
+  f[0].m = &g.start();
+  f[0].i = 0;
+  f[0].level = iter;
+  g.evaluate(g.start(), &r[0], f[0].v);
+
+  for (int k = 0; k >= 0;) {
+    Frame &w = f[k];
+
+    if (w.i == static_cast<int>(w.m->symbol.size())) {
+      --k;
+      continue;
+    }
+
+    const int i = w.i++;
+    const char c = w.m->symbol[i];
+    const double *a = w.v + w.m->first[i];
+    const int n = w.m->first[i + 1] - w.m->first[i];
+    const Parametric::Successor *q;
+
+    if (w.level > 0 && (q = g.apply(c, a, n, &r[0], f[k + 1].v)) != 0) {
+      Frame &u = f[++k];                    // 規則があればその後続のモジュール列を積む
+      u.m = q;
+      u.i = 0;
+      u.level = w.level - 1;
+    }
+    else
+      turtle.move(c, a, n);                 // 書き換えないモジュールはそのまま処理する
+  }
+}
+
+/*
+** 部分木を使い回す生成文法の処理
+**   文字列 p～e の書き換えられる記号は, 再帰レベル iter の部分木の実体を現在位置に置く
+**   （文字列の後に続く記号がなく書き換えた後の座標系が使われないなら last を true にする）
+*/
+void Tree::replicate(const char *p, const char *e, int iter, bool last)
+{
+  for (; p < e; ++p) {
+    if (iter > 0 && grammar.successor(*p) != 0) {
+      const bool done = p + 1 < e ? p[1] == ']' : last;
+      if (reach != 0 && coarse(turtle, *p, iter, done)) continue;
+      const Instance *a = instance(*p, iter, reach != 0 && done);
+      turtle.place(a->point, a->npoint, a->branch, a->nbranch, a->exit);
+    }
+    else
+      turtle.move(*p);
+  }
+}
+
+/*
+** 部分木の実体
+**   記号 c を再帰レベル iter で書き換えた部分木を局所座標系で一度だけ生成する
+**   （出口の座標系が使われない (last が true) なら向きを変える部分木も打ち切れるので別に生成する）
+*/
+const Tree::Instance *Tree::instance(char c, int iter, bool last)
+{
+  Instance *&a = memo[(iter * 256 + static_cast<unsigned char>(c)) * 2 + last];
+
+  if (a == 0) {
+    // 生成中の木の状態を退避する
+    const Turtle t(turtle);
+
+    // 部分木の大きさは文法から求まる
+    const char str[] = { c, '\0' };
+    Size size;
+    measure(grammar, str, iter, ncs, size);
+
+    // 部分木を局所座標系で生成する
+    Buffer<Scalar[3]> sp(size.nspine <= INT_MAX ? static_cast<int>(size.nspine) : 1024);
+    Buffer<int> bp(size.pop <= INT_MAX ? static_cast<int>(size.pop) : 1024);
+    turtle.output(&sp, &bp);
+    turtle.frame().loadIdentity();
+    const char *q = grammar.successor(c);
+    replicate(q, q + grammar.size(c), iter - 1, last);
+
+    // 部分木の実体に格納する
+    a = new Instance;
+    a->npoint = sp.size();
+    a->point = sp.adopt();
+    a->nbranch = bp.size();
+    a->branch = bp.adopt();
+    a->exit = turtle.frame();
+
+    // 生成中の木の状態を元に戻す
+    turtle = t;
+  }
+
+  return a;
+}
+
+/*
+** 上限で飽和する和と積
+*/
+static unsigned long long add(unsigned long long a, unsigned long long b)
+{
+  return a > ULLONG_MAX - b ? ULLONG_MAX : a + b;
+}
+
+static unsigned long long scale(unsigned long long a, unsigned long long b)
+{
+  return a != 0 && b > ULLONG_MAX / a ? ULLONG_MAX : a * b;
+}
+
+/*
+** 生成される木の大きさの計算
+**   文法 g の成長行列から記号の数を求め, 節点数と必要なメモリ量を size に格納する
+*/
+void Tree::measure(const Grammar &g, const char *initial, int level, int n, Size &size)
+{
+  unsigned long long count[256];
+  g.count(initial, level, count);
+
+  size.symbol = 0;
+  for (int i = 0; i < 256; ++i)
+    size.symbol = count[i] > ULLONG_MAX - size.symbol ? ULLONG_MAX : size.symbol + count[i];
+  size.forward = count['F'];
+  size.push = count['['];
+  size.pop = count[']'];
+
+  // 根元と F と ] で節点がひとつずつ増え, 最後に終端の分岐が加わる
+  size.nspine = size.forward < ULLONG_MAX - size.pop ? 1 + size.forward + size.pop : ULLONG_MAX;
+  size.nbranch = size.pop < ULLONG_MAX ? 1 + size.pop : ULLONG_MAX;
+  size.spine = scale(size.nspine, 3 * sizeof (Scalar));
+  size.branch = scale(size.nbranch, sizeof (int));
+
+  // 押し出し形状は節点がふたつ以上ある分岐ごとに作り, その頂点と指標と図形の数は
+  // extrusionSize で求まる分岐の節点の数の一次式なので, 節点がふたつとみっつの分岐の差を
+  // 節点ひとつ分として分岐の数と節点の数から合計する
+  const unsigned long long single = g.single(initial, level);
+  if (size.nspine == ULLONG_MAX || size.nbranch == ULLONG_MAX || single > size.nbranch) {
+    size.mesh = ULLONG_MAX;
+    return;
+  }
+  // （確率的な規則や文脈のある規則の上限の数で分岐の節点がふたつに満たなければ, 節点を分岐に配る）
+  const unsigned long long nodes = size.nspine - single;
+  const unsigned long long multi = size.nbranch - single < nodes / 2 ? size.nbranch - single : nodes / 2;
+  const unsigned long long extra = nodes - 2 * multi;
+  int two[3], three[3];
+  extrusionSize(n, 2, two);
+  extrusionSize(n, 3, three);
+
+  const unsigned long long unit[] = {
+    6 * sizeof (Scalar),                        // 頂点（位置と法線の６要素）
+    sizeof (unsigned int),                      // 指標
+    sizeof (Mesh<Scalar>::Primitive),           // 図形
+  };
+  size.mesh = 0;
+  for (int i = 0; i < 3; ++i) {
+    const unsigned long long count = add(scale(multi, two[i]), scale(extra, three[i] - two[i]));
+    size.mesh = add(size.mesh, scale(count, unit[i]));
+  }
+}
+
+/*
+** 生成される木の大きさの見積り（木を生成せずに成長行列から求める）
+**   パラメータ付きの規則は条件によって書き換えが変わるので見積もらない
+*/
+void Tree::estimate(
+                    Size &size,                // 見積もった大きさ
+                    const char *initial,       // 初期文字列
+                    const char * const *rule,  // 書き換え規則
+                    int level,                 // 再帰レベル
+                    int n                      // 木の側面数
+                    )
+{
+  const Grammar g(rule);
+  measure(g, initial, level, n, size);
+}
+
+/*
+** 規則のない生成文法
+*/
+static const char * const none[] = { 0 };
+
+/*
+** コンストラクタ（木の生成）
+*/
+Tree::Tree(
+           const char *initial,       // 初期文字列
+           const char * const *rule,  // 書き換え規則
+           int level,                 // 再帰レベル
+           const double *direction,   // 木が伸びる方向
+           double rstep,              // 軸中心の回転の角度ステップ
+           double bstep,              // 曲げ方向の角度ステップ
+           double r,                  // 木の根元の半径
+           int n,                     // 木の側面数
+           unsigned int option,       // 生成方法
+           unsigned long long seed,   // 確率的な規則の乱数の種
+           const Detail *detail       // 詳細度による書き換えの打ち切り
+           )
+  : grammar(rule), turtle(rstep * M_PI / 180.0, bstep * M_PI / 180.0, direction)
+{
+  // ポインタの初期化
+  spine = 0;
+  branch = 0;
+  memo = 0;
+  reach = advance = 0;
+  turn = 0;
+  view = false;
+  cs = 0;
+  mesh = 0;
+
+  // 書き換えの作業スタックは再帰レベルの深さ分あればよい
+  work = new Work[level + 1];
+
+  // 根元の半径と断面形状
+  section(r, n);
+
+  // 詳細度で打ち切るなら部分木の広がりを文法から求めておく
+  // （括弧が閉じていなければ部分木を飛ばすと座標系の保存と復帰が対応しなくなる）
+  const bool parametric = Parametric::detect(initial, rule);
+  if (detail != 0 && grammar.balanced() && !grammar.sensitive() && !parametric) {
+    reach = new double[(level + 1) * 256 * 2];
+    advance = reach + (level + 1) * 256;
+    turn = new bool[(level + 1) * 256];
+    grammar.extent(level, reach, advance, turn);
+
+    // 部分木の長さは前進 (F) の数で求まるので打ち切る大きさも前進の長さで割っておく
+    const double unit = direction != 0
+      ? sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2])
+      : 1.0;
+    limit = unit > 0.0 ? detail->size / unit : 0.0;
+
+    if (detail->eye != 0) {
+      eye[0] = detail->eye[0];
+      eye[1] = detail->eye[1];
+      eye[2] = detail->eye[2];
+      view = true;
+    }
+  }
+
+  // 骨格と分岐は伸長可能なバッファに一度の書き換えで生成する
+  // （確率的な規則や文脈のある規則やパラメータ付きの規則がなく, 詳細度で打ち切らなければ
+  //   節点数は文法から予測できるので最初のチャンクで過不足なく確保しておく）
+  Size size;
+  measure(grammar, initial, level, ncs, size);
+  const bool exact = !grammar.stochastic() && !grammar.sensitive() && !parametric && reach == 0;
+  Buffer<Scalar[3]> sp(exact && size.nspine <= INT_MAX ? static_cast<int>(size.nspine) : 1024);
+  Buffer<int> bp(exact && size.nbranch <= INT_MAX ? static_cast<int>(size.nbranch) : 1024);
+  begin(sp, bp);
+
+  // タートルの座標系の保存先は入れ子の深さ分を先に確保しておく
+  if (!parametric) turtle.reserve(grammar.depth(initial, level));
+
+  // 木を生成する
+  if (parametric) {
+    const Parametric g(initial, rule);
+    for (std::vector<std::string>::size_type i = 0; i < g.errors().size(); ++i)
+      fprintf(stderr, "Ignored an invalid rule: %s\n", g.errors()[i].c_str());
+    turtle.reserve(g.depth(level));
+    expand(g, level);
+  }
+  else if (grammar.sensitive()) {
+    // 文脈のある規則は各再帰レベルの文字列を作って書き換える
+    std::vector<char> s;
+    grammar.rewrite(initial, level, seed, s);
+    for (std::vector<char>::size_type i = 0; i < s.size(); ++i) turtle.move(s[i]);
+  }
+  else if ((option & INSTANCE) != 0 && grammar.balanced() && !grammar.stochastic() && !view) {
+    // 後続文字列の括弧が閉じていれば部分木は座標系の保存・復帰に影響しないので
+    // 局所座標系で生成したものを使い回せる（確率的な規則では部分木ごとに形が違い,
+    // 視点からの距離で打ち切るなら置く位置ごとに形が違う）
+    memo = new Instance *[(level + 1) * 256 * 2];
+    for (int i = 0; i < (level + 1) * 256 * 2; ++i) memo[i] = 0;
+
+    replicate(initial, initial + strlen(initial), level, true);
+
+    for (int i = 0; i < (level + 1) * 256 * 2; ++i) {
+      if (memo[i] != 0) {
+        delete[] memo[i]->point;
+        delete[] memo[i]->branch;
+        delete memo[i];
+      }
+    }
+    delete[] memo;
+    memo = 0;
+  }
+  else if ((option & PARALLEL) != 0 && grammar.balanced())
+    parallel(initial, level, sp, bp, seed);
+  else {
+    work->p = work->s = initial;
+    work->e = initial + strlen(initial);
+    work->key = seed;
+    work->level = level;
+    production(turtle, work);
+  }
+
+  end(sp, bp);
+}
+
+/*
+** コンストラクタ（書き換えた命令列からの木の生成）
+**   書き換えは済んでいるので, 同じ命令列から角度や半径を変えた木を何度でも安く生成できる
+*/
+Tree::Tree(
+           const Expansion &expansion,  // 書き換えた命令列
+           const double *direction,   // 木が伸びる方向
+           double rstep,              // 軸中心の回転の角度ステップ
+           double bstep,              // 曲げ方向の角度ステップ
+           double r,                  // 木の根元の半径
+           int n                      // 木の側面数
+           )
+  : grammar(none), turtle(rstep * M_PI / 180.0, bstep * M_PI / 180.0, direction)
+{
+  // ポインタの初期化
+  spine = 0;
+  branch = 0;
+  memo = 0;
+  reach = advance = 0;
+  turn = 0;
+  view = false;
+  cs = 0;
+  mesh = 0;
+  work = 0;
+
+  // 根元の半径と断面形状
+  section(r, n);
+
+  // 節点数はわかっているので最初のチャンクで過不足なく確保しておく
+  Buffer<Scalar[3]> sp(expansion.nodes());
+  Buffer<int> bp(expansion.branches());
+  begin(sp, bp);
+  turtle.reserve(expansion.depth());
+
+  // まとめた回転の並びはこの木の角度でひとつの回転にしておく
+  std::vector<Frame> table(expansion.turns());
+  for (int k = 0; k < expansion.turns(); ++k) {
+    Turtle t(turtle);
+    t.frame().loadIdentity();
+    for (const char *c = expansion.turn(k); *c; ++c) t.move(*c);
+    table[k] = t.frame();
+  }
+
+  // 命令列をタートルで解釈する
+  const char *c = expansion.data();
+  for (const char *e = c + expansion.size(); c < e; ++c) {
+    const unsigned char u = static_cast<unsigned char>(*c);
+
+    if (u >= Expansion::TURN)
+      turtle.frame().multiply(table[u - Expansion::TURN]);
+    else
+      turtle.move(*c);
+  }
+
+  end(sp, bp);
+}
+
+/*
+** 根元の半径と断面形状の設定
+*/
+void Tree::section(double r, int n)
+{
+  radius = r;
+
+  ncs = (n <= EXTRUSION_CS_LIMIT) ? n : EXTRUSION_CS_LIMIT;
+  cs = new Scalar[ncs][2];
+  for (int i = 0; i < ncs; ++i) {
+    double t = 2.0 * M_PI * (double)i / (double)ncs;
+    
+    cs[i][0] = static_cast<Scalar>(radius * cos(t));
+    cs[i][1] = static_cast<Scalar>(radius * sin(t));
+  }
+}
+
+/*
+** 生成の開始
+**   タートルの出力先を骨格と分岐のバッファにして, 最初の節点に木の根元の位置を設定する
+*/
+void Tree::begin(Buffer<Scalar[3]> &sp, Buffer<int> &bp)
+{
+  turtle.output(&sp, &bp);
+
+  Scalar *p = sp.push();
+  p[0] = static_cast<Scalar>(Turtle::base[0] / Turtle::base[3]);
+  p[1] = static_cast<Scalar>(Turtle::base[1] / Turtle::base[3]);
+  p[2] = static_cast<Scalar>(Turtle::base[2] / Turtle::base[3]);
+}
+
+/*
+** 生成の終了
+**   最後の分岐に最後の節点番号を登録して, バッファの内容を骨格と分岐の配列として引き取る
+*/
+void Tree::end(Buffer<Scalar[3]> &sp, Buffer<int> &bp)
+{
+  bp.push() = sp.size();
+
+  nspine = sp.size();
+  nbranch = bp.size();
+  spine = sp.adopt();
+  branch = bp.adopt();
+  turtle.output(0, 0);
+}
+
+/*
+** デストラクタ（メモリ解放）
+*/
+Tree::~Tree()
+{
+  delete[] spine;
+  spine = 0;
+  
+  delete[] branch;
+  branch = 0;
+  
+  delete[] cs;
+  cs = 0;
+
+  delete[] work;
+  work = 0;
+
+  delete[] reach;
+  reach = advance = 0;
+  delete[] turn;
+  turn = 0;
+
+  delete mesh;
+  mesh = 0;
+}
+
+/*
+** 分岐の範囲の押し出し
+**   first 番目から last - 1 番目までの分岐を押し出した頂点と図形を part に書き込む
+*/
+void Tree::sweep(int first, int last, Mesh<Scalar>::Part &part) const
+{
+  for (int i = first, j = first > 0 ? branch[first - 1] : 0; i < last; ++i) {
+    extrusion(cs, ncs, spine + j, branch[i] - j, part);
+    j = branch[i];
+  }
+}
+
+/*
+** スレッドで押し出す分岐の範囲
+*/
+struct Tree::Sweep : public Pool::Task {
+  const Tree *tree;               // 押し出す木
+  int first;                      // 最初の分岐の番号
+  int last;                       // 最後の分岐の次の番号
+  Mesh<Scalar>::Part part;        // 書き込み先
+
+  Sweep(const Tree *tree, int first, int last, const unsigned long long *offset)
+    : tree(tree), first(first), last(last)
+    , part(*tree->mesh, static_cast<int>(offset[0]), static_cast<int>(offset[1]), static_cast<int>(offset[2])) {};
+
+  // 範囲の分岐を逐次処理と同じ手順で押し出す
+  void run() { tree->sweep(first, last, part); };
+};
+
+/*
+** 押し出し形状の作成
+**   骨格を分岐ごとに押し出した頂点と図形を一度だけ作っておき, 描画ではそれを送るだけにする
+**   （節点ごとの断面の頂点を節間ごとの側面の三角形ストリップで共有し, 分岐ごとの両端の蓋は
+**     蓋の法線を持つ頂点を別に作る）
+**   分岐ごとの頂点数と指標の数と図形の数は骨格から求まるので, その累積和を各分岐の書き込み先の
+**   位置にして配列を一度に確保し, 分岐の範囲ごとに複数のスレッドで押し出す
+**   （書き込む位置はスレッド数によらないので結果は逐次処理と同じになる）
+*/
+void Tree::buildMesh(int nthread)
+{
+  // 分岐ごとの頂点数と指標の数と図形の数の累積和
+  std::vector<unsigned long long> offset((nbranch + 1) * 3, 0);
+  for (int i = 0, j = 0; i < nbranch; ++i) {
+    int size[3];
+    extrusionSize(ncs, branch[i] - j, size);
+    for (int k = 0; k < 3; ++k) offset[(i + 1) * 3 + k] = offset[i * 3 + k] + size[k];
+    j = branch[i];
+  }
+
+  // 頂点番号と指標の番号が int に収まらなければ作らない（描画は毎回押し出す）
+  const unsigned long long *total = &offset[nbranch * 3];
+  delete mesh;
+  mesh = 0;
+  if (total[0] > INT_MAX || total[1] > INT_MAX || total[2] > INT_MAX) return;
+
+  mesh = new Mesh<Scalar>;
+  mesh->allocate(static_cast<int>(total[0]), static_cast<int>(total[1]), static_cast<int>(total[2]));
+
+  if (nthread == 1) {
+    Mesh<Scalar>::Part part(*mesh);
+    sweep(0, nbranch, part);
+  }
+  else {
+    Pool pool(nthread);
+
+    // 頂点数がほどよく揃うように分岐を区切って仕事にする（スレッドあたり 16 個程度）
+    unsigned long long grain = total[0] / (pool.size() * 16);
+    if (grain < 1024) grain = 1024;
+
+    for (int first = 0; first < nbranch;) {
+      int last = first + 1;
+      while (last < nbranch && offset[last * 3] - offset[first * 3] < grain) ++last;
+      pool.submit(new Sweep(this, first, last, &offset[first * 3]));
+      first = last;
+    }
+
+    pool.wait();
+  }
+}
+
+/*
+** 木の描画
+*/
+void Tree::draw()
+{
+  // 押し出し形状を作ってあればそれを送るだけにする
+  if (mesh != 0) {
+    mesh->draw();
+    return;
+  }
+
+  for (int i = 0, j = 0; i < nbranch; ++i) {
+#if 1
+    extrusion(cs, ncs, spine + j, branch[i] - j);
+    j = branch[i];
+#else
+    glBegin(GL_LINE_STRIP);
+    while (j < branch[i]) glVertex4dv(spine[j++]);
+    glEnd();
+#endif
+  }
+}
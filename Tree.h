@@ -1,42 +1,122 @@
-/*
-** L-System ɂ؂̐
-*/
-#ifndef TREE_H
-#define TREE_H
-
-#include "Matrix.h"
-
-class Tree {
-  double rotate;                  // ] (+/-) ̊px̃Xebv
-  double bend;                    // ܂Ȃ (>/<) px̃Xebv
-  double radius;                  // ؂̍̔a
-  double top[4];                  // ̎}̐[̈ʒui؂Lтj
-  static const double base[4];    // ̎}̍̈ʒui_j
-  double (*spine)[3];             // i̒_ʒu
-  int nspine;                     // i̒_
-  int *branch;                    // ʒu̒_ԍ
-  int nbranch;                    // ̐
-  int flag;                       // ۂɖ؂𐶐Ȃ 0
-  double (*cs)[2];                // fʂ̒_ʒu
-  int ncs;                        // fʂ̒_
-  Matrix m;                       // Ɨp̕ϊs
-  void turtle(const char *p);
-  void count(const char *p);
-  void production(const char *istr, const char * const *rstr, int iter);
-
-public:
-  Tree(
-    const char *initial,          // 
-    const char * const *rule,     // K
-    int level,                    // ċAx
-    const double *direction = 0,  // ؂Lт
-    double rstep = 120.0,         // S̉]̊pxXebv
-    double bstep = 30.0,          // Ȃ̊pxXebv
-    double r = 0.02,              // ؂̍̔a
-    int n = 8                     // ؂̑ʐ
-    );
-  virtual ~Tree();
-  void draw();
-};
-
-#endif
+/*
+** L-System による木の生成
+*/
+#ifndef TREE_H
+#define TREE_H
+
+#include "Frame.h"
+#include "Buffer.h"
+#include "Expansion.h"
+#include "Grammar.h"
+#include "Mesh.h"
+#include "Parametric.h"
+#include "Turtle.h"
+
+class Tree {
+public:
+  typedef Turtle::Scalar Scalar;  // 骨格と断面の頂点位置の要素の型
+  enum {                          // 生成方法の指定
+    INSTANCE = 1,                 //   同じ（記号, 再帰レベル）の部分木は一度だけ生成して使い回す
+    PARALLEL = 2                  //   分岐の括弧の中を複数のスレッドで生成する
+  };
+  struct Size {                   // 生成される木の大きさ
+    unsigned long long symbol;    //   書き換え後の記号の総数
+    unsigned long long forward;   //   前進 (F) の数
+    unsigned long long push;      //   現在位置保存 ([) の数
+    unsigned long long pop;       //   保存位置復帰 (]) の数
+    unsigned long long nspine;    //   骨格の頂点数
+    unsigned long long nbranch;   //   分岐の数
+    unsigned long long spine;     //   骨格の頂点位置に必要なバイト数
+    unsigned long long branch;    //   分岐位置の頂点番号に必要なバイト数
+    unsigned long long mesh;      //   押し出し形状の頂点と指標と図形に必要なバイト数（確率的な規則や文脈のある規則なら目安）
+  };
+  struct Detail {                 // 詳細度による書き換えの打ち切り
+    double size;                  //   これより小さくなる部分木は書き換えずに１本の枝にする
+    const double *eye;            //   視点の位置（0 ならワールド座標系の長さ, あれば視点からの距離との比で判定する）
+  };
+
+private:
+  double radius;                  // 木の根元の半径
+  Scalar (*spine)[3];             // 骨格の頂点位置
+  int nspine;                     // 骨格の頂点数
+  int *branch;                    // 分岐位置の頂点番号
+  int nbranch;                    // 分岐の数
+  Grammar grammar;                // 生成文法
+  Turtle turtle;                  // 木を生成するタートル
+  struct Work {                   // 書き換えの作業スタックの要素
+    const char *p;                //   次に取り出す文字の位置
+    const char *e;                //   文字列の終端の位置
+    const char *s;                //   文字列の先頭の位置
+    unsigned long long key;       //   文字列を導出した経路の鍵
+    int level;                    //   残りの再帰レベル
+  } *work;                        // 書き換えの作業スタック
+  struct Instance {               // 部分木の実体
+    Scalar (*point)[3];           //   部分木の局所座標系における骨格の頂点位置
+    int npoint;                   //   骨格の頂点数
+    int *branch;                  //   分岐位置の頂点番号（部分木の中での番号）
+    int nbranch;                  //   分岐の数
+    Frame exit;                   //   部分木を展開し終えたときの座標系
+  } **memo;                       // （記号, 再帰レベル, 出口の座標系を使わないか）ごとの部分木の実体
+  struct Block;                   // スレッドで生成する分岐の括弧の中
+  struct Segment;                 // スレッドで生成した骨格と分岐
+  struct Sweep;                   // スレッドで押し出す分岐の範囲
+  double *reach;                  // 記号と再帰レベルごとの部分木の根元から届く長さ（打ち切らなければ 0）
+  double *advance;                // 記号と再帰レベルごとの部分木の幹の長さ
+  bool *turn;                     // 記号と再帰レベルごとの部分木の幹が向きを変えるなら true
+  double limit;                   // 書き換えを打ち切る部分木の大きさ
+  double eye[3];                  // 部分木の大きさを判定する視点の位置
+  bool view;                      // 視点からの距離で判定するなら true
+  Scalar (*cs)[2];                // 断面の頂点位置
+  int ncs;                        // 断面の頂点数
+  Mesh<Scalar> *mesh;             // 押し出し形状（作っていなければ 0）
+  void production(Turtle &t, Work *w) const;
+  void sweep(int first, int last, Mesh<Scalar>::Part &part) const;
+  bool coarse(Turtle &t, char c, int iter, bool last) const;
+  static bool tail(const Work *w, const Work *bottom);
+  void parallel(const char *istr, int iter, Buffer<Scalar[3]> &sp, Buffer<int> &bp,
+                unsigned long long seed);
+  void section(double r, int n);
+  void begin(Buffer<Scalar[3]> &sp, Buffer<int> &bp);
+  void end(Buffer<Scalar[3]> &sp, Buffer<int> &bp);
+  void expand(const Parametric &g, int iter);
+  void replicate(const char *p, const char *e, int iter, bool last);
+  const Instance *instance(char c, int iter, bool last);
+  static void measure(const Grammar &g, const char *initial, int level, int n, Size &size);
+
+public:
+  Tree(
+    const char *initial,          // 初期文字列
+    const char * const *rule,     // 書き換え規則
+    int level,                    // 再帰レベル
+    const double *direction = 0,  // 木が伸びる方向
+    double rstep = 120.0,         // 軸中心の回転の角度ステップ
+    double bstep = 30.0,          // 曲げ方向の角度ステップ
+    double r = 0.02,              // 木の根元の半径
+    int n = 8,                    // 木の側面数
+    unsigned int option = 0,      // 生成方法
+    unsigned long long seed = 0,  // 確率的な規則の乱数の種
+    const Detail *detail = 0      // 詳細度による書き換えの打ち切り（0 なら打ち切らない）
+    );
+  Tree(
+    const Expansion &expansion,   // 書き換えた命令列
+    const double *direction = 0,  // 木が伸びる方向
+    double rstep = 120.0,         // 軸中心の回転の角度ステップ
+    double bstep = 30.0,          // 曲げ方向の角度ステップ
+    double r = 0.02,              // 木の根元の半径
+    int n = 8                     // 木の側面数
+    );
+  virtual ~Tree();
+  static void estimate(
+    Size &size,                   // 見積もった大きさ
+    const char *initial,          // 初期文字列
+    const char * const *rule,     // 書き換え規則
+    int level,                    // 再帰レベル
+    int n = 8                     // 木の側面数
+    );
+  void buildMesh(
+    int nthread = 1               // 押し出すスレッド数（0 ならハードウェアのスレッド数）
+    );
+  void draw();
+};
+
+#endif
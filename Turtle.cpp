@@ -0,0 +1,157 @@
+/*
+** L-System の記号を解釈するタートル
+*/
+#include <cmath>
+#include "Turtle.h"
+
+/*
+** 円周率 M_PI は Visual Studio の cmath では定義されていない
+*/
+#ifndef M_PI
+#  define M_PI 3.14159265358979323846
+#endif
+
+/*
+** 基準の枝の根元の位置（原点）
+*/
+const double Turtle::base[] = { 0.0, 0.0, 0.0, 1.0 };
+
+/*
+** コンストラクタ
+*/
+Turtle::Turtle(double rstep, double bstep, const double *direction)
+  : rotate(rstep), bend(bstep), nstack(0), sbuf(0), bbuf(0)
+{
+  // 木が伸びる方向
+  if (direction != 0) {
+    top[0] = direction[0];
+    top[1] = direction[1];
+    top[2] = direction[2];
+  }
+  else {
+    top[0] = 0.0;
+    top[1] = 1.0;
+    top[2] = 0.0;
+  }
+  top[3] = 1.0;
+  ahead[0] = top[0] / top[3];
+  ahead[1] = top[1] / top[3];
+  ahead[2] = top[2] / top[3];
+
+  // 角度のステップは一定なので回転を作っておく
+  spin[0].rotate( rotate, top);
+  spin[1].rotate(-rotate, top);
+  spin[2].rotate( bend, 0.0, 0.0, 1.0);
+  spin[3].rotate(-bend, 0.0, 0.0, 1.0);
+}
+
+/*
+** タートルの座標系の処理
+**   記号 c で座標系を更新し, 節点ができるなら NODE か BRANCH を返す
+*/
+int Turtle::turn(char c)
+{
+  switch (c) {
+
+  case 'F': // 前進
+    m.translate(ahead);
+    return NODE;
+
+  case '+': // 軸右回転
+    m.multiply(spin[0]);
+    break;
+  case '-': // 軸左回転
+    m.multiply(spin[1]);
+    break;
+
+  case '>': // 右分岐
+    m.multiply(spin[2]);
+    break;
+  case '<': // 左分岐
+    m.multiply(spin[3]);
+    break;
+
+  case '[': // 現在位置保存（確保した深さを超えたときだけ保存先を伸ばす）
+    if (nstack < static_cast<int>(stack.size())) stack[nstack] = m;
+    else stack.push_back(m);
+    ++nstack;
+    break;
+  case ']': // 保存位置復帰
+    m = stack[--nstack];
+    return BRANCH;
+
+  default:
+    break;
+  }
+
+  return NONE;
+}
+
+/*
+** タートルの処理
+**   節点ができればその位置を骨格の頂点位置の格納先に追加し,
+**   分岐ならその頂点番号を分岐位置の格納先に追加する
+*/
+void Turtle::move(char c)
+{
+  const int k = turn(c);
+
+  if (k == BRANCH) bbuf->push() = sbuf->size();
+  if (k != NONE) node(sbuf->push());
+}
+
+/*
+** パラメータ付きのモジュールのタートルの処理
+**   実引数 a[n] の最初の値を, 前進 (F) では枝の長さの倍率, 軸回転 (+/-) と
+**   折り曲げ (>/<) では角度（度）に使う. 実引数がなければステップのまま処理する
+*/
+void Turtle::move(char c, const double *a, int n)
+{
+  if (n <= 0) {
+    move(c);
+    return;
+  }
+
+  const double t = a[0] * M_PI / 180.0;
+
+  switch (c) {
+
+  case 'F': // 前進
+    m.translate(ahead[0] * a[0], ahead[1] * a[0], ahead[2] * a[0]);
+    node(sbuf->push());
+    break;
+
+  case '+': // 軸右回転
+    m.rotate( t, top);
+    break;
+  case '-': // 軸左回転
+    m.rotate(-t, top);
+    break;
+
+  case '>': // 右分岐
+    m.rotate( t, 0.0, 0.0, 1.0);
+    break;
+  case '<': // 左分岐
+    m.rotate(-t, 0.0, 0.0, 1.0);
+    break;
+
+  default:
+    move(c);
+    break;
+  }
+}
+
+/*
+** 部分木の配置
+**   局所座標系の骨格の頂点位置 point と分岐位置 branch を現在の座標系で変換して追加し,
+**   部分木を展開し終えたときの座標系 exit を現在の座標系に続ける
+*/
+void Turtle::place(const Scalar (*point)[3], int npoint, const int *branch, int nbranch,
+                   const Frame &exit)
+{
+  const int n = sbuf->size();
+
+  for (int i = 0; i < nbranch; ++i) bbuf->push() = n + branch[i];
+  m.transform(point, sbuf->push(npoint), npoint);
+  m.multiply(exit);
+}
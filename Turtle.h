@@ -0,0 +1,81 @@
+/*
+** L-System の記号を解釈するタートル
+*/
+#ifndef TURTLE_H
+#define TURTLE_H
+
+#include <vector>
+#include "Frame.h"
+#include "Buffer.h"
+
+/*
+** 骨格の頂点位置を格納する型
+**   座標系の計算は常に double で行い, 頂点位置を格納するときだけこの型にする
+**   （float にすると骨格とその押し出し形状のメモリと描画の転送量が半分になる）
+*/
+#ifndef TREE_SCALAR
+#  define TREE_SCALAR float
+#endif
+
+class Turtle {
+public:
+  typedef TREE_SCALAR Scalar;     // 骨格の頂点位置の要素の型
+
+private:
+  double rotate;                  // 軸回転 (+/-) の角度のステップ
+  double bend;                    // 折り曲げ (>/<) 角度のステップ
+  double top[4];                  // 基準の枝の先端の位置（木が伸びる方向）
+  double ahead[3];                // 前進 (F) で進むベクトル
+  Frame spin[4];                  // 軸回転 (+/-) と折り曲げ (>/<) の回転（この順）
+  Frame m;                        // 現在の座標系
+  std::vector<Frame> stack;       // 保存した座標系（reserve で入れ子の深さ分を確保しておく）
+  int nstack;                     // 保存した座標系の数
+  Buffer<Scalar[3]> *sbuf;        // 骨格の頂点位置の格納先
+  Buffer<int> *bbuf;              // 分岐位置の頂点番号の格納先
+  int turn(char c);
+
+  // 節点の位置（現在の座標系の原点）を p に格納する
+  template <typename T>
+  void node(T *p) const
+  {
+    const double *o = m.position();
+
+    p[0] = static_cast<T>(o[0]);
+    p[1] = static_cast<T>(o[1]);
+    p[2] = static_cast<T>(o[2]);
+  };
+
+public:
+  enum {                          // 記号を処理してできる節点
+    NONE,                         //   節点はできない
+    NODE,                         //   枝の途中の節点 (F)
+    BRANCH                        //   新しい枝の最初の節点 (])
+  };
+  static const double base[4];    // 基準の枝の根元の位置（原点）
+
+  Turtle(
+    double rstep,                 // 軸中心の回転の角度ステップ（ラジアン）
+    double bstep,                 // 曲げ方向の角度ステップ（ラジアン）
+    const double *direction = 0   // 木が伸びる方向
+    );
+  virtual ~Turtle() {};
+
+  // 骨格の頂点位置と分岐位置の頂点番号の格納先を指定する
+  void output(Buffer<Scalar[3]> *s, Buffer<int> *b) { sbuf = s; bbuf = b; };
+
+  // 座標系の保存先を入れ子の深さ n 分確保する
+  void reserve(int n) { if (n > static_cast<int>(stack.size())) stack.resize(n); };
+
+  // 現在の座標系
+  Frame &frame() { return m; };
+  const Frame &frame() const { return m; };
+
+  void move(char c);
+  void move(char c, const double *a, int n);
+
+  // タートルが処理する記号なら true
+  static constexpr bool accepts(char c) { return c == 'F' || c == '+' || c == '-' || c == '<' || c == '>' || c == '[' || c == ']'; };
+  void place(const Scalar (*point)[3], int npoint, const int *branch, int nbranch, const Frame &exit);
+};
+
+#endif
@@ -1,344 +1,529 @@
-/*
-** o`̍쐬
-*/
-#include <cmath>
-#if defined(WIN32)
-//#  pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
-#  undef GL_GLEXT_PROTOTYPES
-#  include "glut.h"
-#elif defined(__APPLE__) || defined(MACOSX)
-#  include <GLUT/glut.h>
-#else
-#  include <GL/glut.h>
-#endif
-#include "extrusion.h"
-
-#define TESSELLATION 0 // gluTess*() gȂ 1 ɂ
-
-/*
-** s̐
-**   R~Rs m1  m2 |
-*/
-static void multiply(const double m1[], const double m2[], double m3[])
-{
-  for (int j = 0; j < 9; j += 3) {
-    double t[3];
-    
-    for (int i = 0; i < 3; ++i) {
-      t[i] = m1[j + 0] * m2[0 + i]
-           + m1[j + 1] * m2[3 + i]
-           + m1[j + 2] * m2[6 + i];
-    }
-    m3[j + 0] = t[0];
-    m3[j + 1] = t[1];
-    m3[j + 2] = t[2];
-  }
-}
-
-/*
-** xNg̕]`
-**   xNg u xNg v Ɍϊs r Ɋi[
-*/
-static void turn(const double u[], const double v[], double r[])
-{
-  /* ʂ̎i]jn = u~v */
-  const double n[] = {
-    u[1] * v[2] - u[2] * v[1],
-    u[2] * v[0] - u[0] * v[2],
-    u[0] * v[1] - u[1] * v[0],
-  };
-  
-  /* n ̒ */
-  double d = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
-  
-  if (d == 0.0) {
-    /* ]Ȃ */
-    r[1] = r[2] = r[3] = r[5] = r[6] = r[7] = 0.0;
-    r[0] = r[4] = r[8] = 1.0;
-  }
-  else {
-    /*
-    ** r : (u, n, u~n)  (x, y, z) ̕ϊs
-    ** s : (x, y, z)  (v, n, v~n) ̕ϊs
-    */
-    double s[9], a = sqrt(d);
-    
-    /* t  y̐Ƃ */
-    r[1] = s[3] = n[0] / a;
-    r[4] = s[4] = n[1] / a;
-    r[7] = s[5] = n[2] / a;
-    
-    /* ux u */
-    a = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
-    r[0] = u[0] / a;
-    r[3] = u[1] / a;
-    r[6] = u[2] / a;
-    
-    /* vx v */
-    a = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
-    s[0] = v[0] / a;
-    s[1] = v[1] / a;
-    s[2] = v[2] / a;
-    
-    /* uz l = u~n */
-    r[2] = u[1] * n[2] - u[2] * n[1];
-    r[5] = u[2] * n[0] - u[0] * n[2];
-    r[8] = u[0] * n[1] - u[1] * n[0];
-    a = sqrt(r[2] * r[2] + r[5] * r[5] + r[8] * r[8]);
-    r[2] /= a;
-    r[5] /= a;
-    r[8] /= a;
-    
-    /* vz m = v~n */
-    s[6] = v[1] * n[2] - v[2] * n[1];
-    s[7] = v[2] * n[0] - v[0] * n[2];
-    s[8] = v[0] * n[1] - v[1] * n[0];
-    a = sqrt(s[6] * s[6] + s[7] * s[7] + s[8] * s[8]);
-    s[6] /= a;
-    s[7] /= a;
-    s[8] /= a;
-    
-    /* r  r s */
-    multiply(r, s, r);
-  }
-}
-
-/*
-** fʂ̂fό`
-**   @xNg v * inverse(m) ̕ʂɉ
-**   z ɂfό`ϊs r Ɋi[
-*/
-static void shear(const double v[], const double m[], double r[])
-{
-  for (int i = 0; i < 9; ++i) r[i] = m[i];
-  
-  const double z = v[0] * m[6] + v[1] * m[7] + v[2] * m[8];
-  
-  if (z != 0.0) {
-    const double x = (v[0] * m[0] + v[1] * m[1] + v[2] * m[2]) / z;
-    const double y = (v[0] * m[3] + v[1] * m[4] + v[2] * m[5]) / z;
-    
-    r[0] -= r[6] * x;
-    r[1] -= r[7] * x;
-    r[2] -= r[8] * x;
-    
-    r[3] -= r[6] * y;
-    r[4] -= r[7] * y;
-    r[5] -= r[8] * y;
-  }
-}
-
-/*
-** Wϊ
-**   n ̒_ v  m ŉ] p ɕsړ̂ t ɓ
-*/
-static void transform(const double v[][2], int n,
-                      const double m[], const double p[], double t[][3])
-{
-  for (int i = 0; i < n; ++i) {
-    t[i][0] = v[i][0] * m[0] + v[i][1] * m[3] + p[0];
-    t[i][1] = v[i][0] * m[1] + v[i][1] * m[4] + p[1];
-    t[i][2] = v[i][0] * m[2] + v[i][1] * m[5] + p[2];
-  }
-}
-
-/*
-** ʂ`
-**   p1: O̒fʂ̒_ʒu
-**   p2: ̒fʂ̒_ʒu
-**   n:  fʂ̖@xNg
-**   nc: fʂ̒_
-**   m:  fʂ̉]̕ϊs
-*/
-static void side(const double p1[][3], const double p2[][3],
-                 const double n[][2], int nc, const double m[])
-{
-  glBegin(GL_TRIANGLE_STRIP);
-  for (int i = 0; i < nc; ++i) {
-    glNormal3d(m[0] * n[i][0] + m[3] * n[i][1],
-               m[1] * n[i][0] + m[4] * n[i][1],
-               m[2] * n[i][0] + m[5] * n[i][1]); 
-    glVertex3dv(p1[i]);
-    glVertex3dv(p2[i]);
-  }
-  glNormal3d(m[0] * n[0][0] + m[3] * n[0][1],
-             m[1] * n[0][0] + m[4] * n[0][1],
-             m[2] * n[0][0] + m[5] * n[0][1]); 
-  glVertex3dv(p1[0]);
-  glVertex3dv(p2[0]);
-  glEnd();
-}
-
-/*
-** W`
-**   p:  fʂ̒_ʒu
-**   n1: `Jn钸_̈ʒu
-**   n2: `I钸_̈ʒu
-**   n:  @xNg
-*/
-static void cap(const double p[][3], int n1, int n2, const double n[])
-{
-  if (n1 != n2) {
-#if TESSELLATION
-    GLUtesselator *tess = gluNewTess();
-    
-    gluTessCallback(tess, GLU_TESS_BEGIN, (GLvoid (CALLBACK *)())glBegin);
-    gluTessCallback(tess, GLU_TESS_VERTEX, (GLvoid (CALLBACK *)())glVertex3dv);
-    gluTessCallback(tess, GLU_TESS_END, (GLvoid (CALLBACK *)())glEnd);
-    
-    gluBeginPolygon(tess);
-    gluTessBeginContour(tess);
-#else
-    glBegin(GL_TRIANGLE_FAN);
-#endif
-    
-    if (n1 < n2) {
-      glNormal3dv(n);
-      for (int i = n1; i <= n2; ++i) {
-#if TESSELLATION
-        gluTessVertex(tess, (GLdouble *)p[i], (GLdouble *)p[i]);
-#else
-        glVertex3dv(p[i]);
-#endif
-      }
-    }
-    else {
-      glNormal3d(-n[0], -n[1], -n[2]);
-      for (int i = n1; i >= n2; --i) {
-#if TESSELLATION
-        gluTessVertex(tess, (GLdouble *)p[i], (GLdouble *)p[i]);
-#else
-        glVertex3dv(p[i]);
-#endif
-      }
-    }
-
-#if TESSELLATION
-    gluTessEndContour(tess);
-    gluEndPolygon(tess);
-    
-    gluDeleteTess(tess);
-#else
-    glEnd();
-#endif
-  }
-}
-
-/*
-** o
-**   cs: fʌ` (cross section)
-**   nc: fʂ̒_
-**   sp: ooH (spine)
-**   ns: oH̐ߓ_̐iN_ƏI_܂ށj
-*/
-void extrusion(const double cs[][2], int nc, const double sp[][3], int ns)
-{
-  if (--ns > 0) {
-    
-    /* ܂蒸_̑fʂ͐؂l߂ */
-    if (nc > EXTRUSION_CS_LIMIT) nc = EXTRUSION_CS_LIMIT;
-    
-    /* fʂ̖@xNg n ߂ (z = 0) */
-    double n[EXTRUSION_CS_LIMIT][2], x, y, a;
-    
-    for (int i = 1; i < nc; ++i) {
-      x = cs[i][0] - cs[i - 1][0];
-      y = cs[i][1] - cs[i - 1][1];
-      a = x * x + y * y;
-      
-      if (a != 0.0) {
-        a = sqrt(a);
-        n[i][0] = y / a;
-        n[i][1] = -x / a;
-      }
-    }
-
-    x = cs[0][0] - cs[nc - 1][0];
-    y = cs[0][1] - cs[nc - 1][1];
-    a = x * x + y * y;
-
-    if (a != 0.0) {
-      a = sqrt(a);
-      n[0][0] = y / a;
-      n[0][1] = -x / a;
-    }
-    
-    /* ړ_ɐiEޏo̕xNg v */
-    double v[2][3];
-
-    /* fʂ̎xNgifʂXYʏŒ`j */
-    v[0][0] = 0.0;
-    v[0][1] = 0.0;
-    v[0][2] = 1.0;
-    
-    /* N_̐i̕xNg͑ޏo̕xNgƈv */
-    v[1][0] = sp[1][0] - sp[0][0];
-    v[1][1] = sp[1][1] - sp[0][1];
-    v[1][2] = sp[1][2] - sp[0][2];
-    a = sqrt(v[1][0] * v[1][0] + v[1][1] * v[1][1] + v[1][2] * v[1][2]);
-    v[1][0] /= a;
-    v[1][1] /= a;
-    v[1][2] /= a;
-    
-    /* fʂN_ɂi̕xNǧɉ]s m */
-    double m[9];
-    turn(v[0], v[1], m);
-    
-    /* ړ_ɂfʂ̒_ʒu p ͒fʂ̍Wl m ŕϊċ߂ */
-    double p[2][EXTRUSION_CS_LIMIT][3];
-    transform(cs, nc, m, sp[0], p[1]);
-    
-    /* N_̒fʂ` */
-    cap(p[1], nc - 1, 0, v[1]);
-    
-    /* NEޏo̐؂ւ */
-    int k = 0;
-    
-    for (int i = 1; i < ns; ++i) {
-      
-      /* ޏo̕xNg */
-      v[k][0] = sp[i + 1][0] - sp[i][0];
-      v[k][1] = sp[i + 1][1] - sp[i][1];
-      v[k][2] = sp[i + 1][2] - sp[i][2];
-      a = sqrt(v[k][0] * v[k][0] + v[k][1] * v[k][1] + v[k][2] * v[k][2]);
-      v[k][0] /= a;
-      v[k][1] /= a;
-      v[k][2] /= a;
-      
-      /* ԃxNgfʂ̖@xNg */
-      double h[] = {
-        v[k][0] + v[1 - k][0],
-        v[k][1] + v[1 - k][1],
-        v[k][2] + v[1 - k][2],
-      };
-      
-      /* ԃxNg h ɒfʂ߂ϊ r */
-      double r[9];
-      shear(h, m, r);
-
-      /* ԃxNg h ɂfʌ`߂ */
-      transform(cs, nc, r, sp[i], p[k]);
-      
-      /* ʂ` */
-      side(p[k], p[1 - k], n, nc, m);
-      
-      /* i̕xNgޏo̕xNgɉ]s r */
-      turn(v[1 - k], v[k], r);
-      
-      /* fʂޏo̕xNǧɉ]s m */
-      multiply(m, r, m);
-      
-      /* iƑޏoւ */
-      k = 1 - k;
-    }
-    
-    /* I_̒fʂ͂ЂƂO̒fʂƓňʒû݂قȂ */
-    transform(cs, nc, m, sp[ns], p[k]);
-    
-    /* ʂ` */
-    side(p[k], p[1 - k], n, nc, m);
-    
-    /* I_̒fʂ` */
-    cap(p[k], 0, nc - 1, v[1 - k]);
-  }
-}
+/*
+** 押し出し形状の作成
+*/
+#include <cmath>
+#if defined(WIN32)
+//#  pragma comment(linker, "/subsystem:\"windows\" /entry:\"mainCRTStartup\"")
+#  undef GL_GLEXT_PROTOTYPES
+#  include "glut.h"
+#elif defined(__APPLE__) || defined(MACOSX)
+#  include <GLUT/glut.h>
+#else
+#  include <GL/glut.h>
+#endif
+#include "extrusion.h"
+#include "Simd.h"
+
+#define TESSELLATION 0 // gluTess*() を使うなら 1 にする
+
+/*
+** 行列の積
+**   ３×３行列の m1 に m2 を掛ける
+*/
+static void multiply(const double m1[], const double m2[], double m3[])
+{
+  for (int j = 0; j < 9; j += 3) {
+    double t[3];
+    
+    for (int i = 0; i < 3; ++i) {
+      t[i] = m1[j + 0] * m2[0 + i]
+           + m1[j + 1] * m2[3 + i]
+           + m1[j + 2] * m2[6 + i];
+    }
+    m3[j + 0] = t[0];
+    m3[j + 1] = t[1];
+    m3[j + 2] = t[2];
+  }
+}
+
+/*
+** ベクトルの方向転換`
+**   ベクトル u をベクトル v 方向に向ける変換行列を r に格納する
+*/
+static void turn(const double u[], const double v[], double r[])
+{
+  /* 共通の軸（回転軸）n = u×v */
+  const double n[] = {
+    u[1] * v[2] - u[2] * v[1],
+    u[2] * v[0] - u[0] * v[2],
+    u[0] * v[1] - u[1] * v[0],
+  };
+  
+  /* n の長さ */
+  double d = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+  
+  if (d == 0.0) {
+    /* 回転しない */
+    r[1] = r[2] = r[3] = r[5] = r[6] = r[7] = 0.0;
+    r[0] = r[4] = r[8] = 1.0;
+  }
+  else {
+    /*
+    ** r : (u, n, u×n) → (x, y, z) の変換行列
+    ** s : (x, y, z) → (v, n, v×n) の変換行列
+    */
+    double s[9], a = sqrt(d);
+    
+    /* t を y軸の成分とする */
+    r[1] = s[3] = n[0] / a;
+    r[4] = s[4] = n[1] / a;
+    r[7] = s[5] = n[2] / a;
+    
+    /* u側のx軸 u */
+    a = sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+    r[0] = u[0] / a;
+    r[3] = u[1] / a;
+    r[6] = u[2] / a;
+    
+    /* v側のx軸 v */
+    a = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    s[0] = v[0] / a;
+    s[1] = v[1] / a;
+    s[2] = v[2] / a;
+    
+    /* u側のz軸 l = u×n */
+    r[2] = u[1] * n[2] - u[2] * n[1];
+    r[5] = u[2] * n[0] - u[0] * n[2];
+    r[8] = u[0] * n[1] - u[1] * n[0];
+    a = sqrt(r[2] * r[2] + r[5] * r[5] + r[8] * r[8]);
+    r[2] /= a;
+    r[5] /= a;
+    r[8] /= a;
+    
+    /* v側のz軸 m = v×n */
+    s[6] = v[1] * n[2] - v[2] * n[1];
+    s[7] = v[2] * n[0] - v[0] * n[2];
+    s[8] = v[0] * n[1] - v[1] * n[0];
+    a = sqrt(s[6] * s[6] + s[7] * s[7] + s[8] * s[8]);
+    s[6] /= a;
+    s[7] /= a;
+    s[8] /= a;
+    
+    /* r ← r s */
+    multiply(r, s, r);
+  }
+}
+
+/*
+** 断面のせん断変形
+**   法線ベクトルが v * inverse(m) の平面に沿って
+**   z 軸方向にせん断変形する変換行列を r に格納する
+*/
+static void shear(const double v[], const double m[], double r[])
+{
+  for (int i = 0; i < 9; ++i) r[i] = m[i];
+  
+  const double z = v[0] * m[6] + v[1] * m[7] + v[2] * m[8];
+  
+  if (z != 0.0) {
+    const double x = (v[0] * m[0] + v[1] * m[1] + v[2] * m[2]) / z;
+    const double y = (v[0] * m[3] + v[1] * m[4] + v[2] * m[5]) / z;
+    
+    r[0] -= r[6] * x;
+    r[1] -= r[7] * x;
+    r[2] -= r[8] * x;
+    
+    r[3] -= r[6] * y;
+    r[4] -= r[7] * y;
+    r[5] -= r[8] * y;
+  }
+}
+
+/*
+** 座標変換
+**   x 座標値を v[0], y 座標値を v[1] に並べた n 個の頂点を m で回転した後 p に平行移動したものを t に得る
+**   （断面全体を Simd::transformRing で double のまままとめて計算し, 結果だけを頂点位置の型 T にする）
+*/
+template <typename T>
+static void transform(const double v[][EXTRUSION_CS_LIMIT], int n,
+                      const double m[], const T p[], T t[][3])
+{
+  const double q[] = { p[0], p[1], p[2] };
+  double r[3][EXTRUSION_CS_LIMIT];
+
+  Simd::transformRing(m, q, v[0], v[1], r[0], r[1], r[2], n);
+
+  for (int i = 0; i < n; ++i) {
+    t[i][0] = static_cast<T>(r[0][i]);
+    t[i][1] = static_cast<T>(r[1][i]);
+    t[i][2] = static_cast<T>(r[2][i]);
+  }
+}
+
+/*
+** 法線ベクトルの回転
+**   x 成分を n[0], y 成分を n[1] に並べた nc 個の断面の法線ベクトルを m で回転したものを
+**   成分ごとに r[0], r[1], r[2] に得る
+*/
+static void rotate(const double n[][EXTRUSION_CS_LIMIT], int nc, const double m[],
+                   double r[][EXTRUSION_CS_LIMIT])
+{
+  // 平行移動しない（-0.0 なら足しても 0 の符号まで変わらない）
+  static const double origin[] = { -0.0, -0.0, -0.0 };
+
+  Simd::transformRing(m, origin, n[0], n[1], r[0], r[1], r[2], nc);
+}
+
+/*
+** 頂点位置と法線ベクトルの指定（頂点位置の型に合わせた関数を使う）
+*/
+static void vertex(const GLfloat *p) { glVertex3fv(p); }
+static void vertex(const GLdouble *p) { glVertex3dv(p); }
+static void normal(GLfloat x, GLfloat y, GLfloat z) { glNormal3f(x, y, z); }
+static void normal(GLdouble x, GLdouble y, GLdouble z) { glNormal3d(x, y, z); }
+
+/*
+** 描画による出力
+**   押し出し形状の側面と蓋をそのまま GL に送る
+*/
+template <typename T>
+class Immediate {
+public:
+  // 断面を追加する（描画では側面や蓋を描くときに断面の頂点位置を送るので何もしない）
+  void ring(const T p[][3], int nc, const double n[][EXTRUSION_CS_LIMIT], const double m1[], const double m2[]) {};
+
+  /*
+  ** 側面を描く
+  **   p1: 前の断面の頂点位置
+  **   p2: 今の断面の頂点位置
+  **   n:  断面の法線ベクトル
+  **   nc: 断面の頂点数
+  **   m:  断面の回転の変換行列
+  */
+  void side(const T p1[][3], const T p2[][3], const double n[][EXTRUSION_CS_LIMIT], int nc, const double m[])
+  {
+    double r[3][EXTRUSION_CS_LIMIT];
+    rotate(n, nc, m, r);
+
+    glBegin(GL_TRIANGLE_STRIP);
+    for (int i = 0; i < nc; ++i) {
+      normal(static_cast<T>(r[0][i]), static_cast<T>(r[1][i]), static_cast<T>(r[2][i]));
+      vertex(p1[i]);
+      vertex(p2[i]);
+    }
+    normal(static_cast<T>(r[0][0]), static_cast<T>(r[1][0]), static_cast<T>(r[2][0]));
+    vertex(p1[0]);
+    vertex(p2[0]);
+    glEnd();
+  };
+
+  /*
+  ** 蓋を描く
+  **   p:  断面の頂点位置
+  **   n1: 描画を開始する頂点の位置
+  **   n2: 描画を終了する頂点の位置
+  **   n:  法線ベクトル
+  */
+  void cap(const T p[][3], int n1, int n2, const double n[])
+  {
+    if (n1 != n2) {
+#if TESSELLATION
+      GLUtesselator *tess = gluNewTess();
+      GLdouble q[EXTRUSION_CS_LIMIT][3];  // gluTessVertex に渡す頂点位置
+      for (int i = 0, nq = (n1 > n2 ? n1 : n2) + 1; i < nq; ++i) {
+        q[i][0] = p[i][0];
+        q[i][1] = p[i][1];
+        q[i][2] = p[i][2];
+      }
+
+      gluTessCallback(tess, GLU_TESS_BEGIN, (GLvoid (CALLBACK *)())glBegin);
+      gluTessCallback(tess, GLU_TESS_VERTEX, (GLvoid (CALLBACK *)())glVertex3dv);
+      gluTessCallback(tess, GLU_TESS_END, (GLvoid (CALLBACK *)())glEnd);
+
+      gluBeginPolygon(tess);
+      gluTessBeginContour(tess);
+#else
+      glBegin(GL_TRIANGLE_FAN);
+#endif
+
+      if (n1 < n2) {
+        normal(static_cast<T>(n[0]), static_cast<T>(n[1]), static_cast<T>(n[2]));
+        for (int i = n1; i <= n2; ++i) {
+#if TESSELLATION
+          gluTessVertex(tess, q[i], q[i]);
+#else
+          vertex(p[i]);
+#endif
+        }
+      }
+      else {
+        normal(static_cast<T>(-n[0]), static_cast<T>(-n[1]), static_cast<T>(-n[2]));
+        for (int i = n1; i >= n2; --i) {
+#if TESSELLATION
+          gluTessVertex(tess, q[i], q[i]);
+#else
+          vertex(p[i]);
+#endif
+        }
+      }
+
+#if TESSELLATION
+      gluTessEndContour(tess);
+      gluEndPolygon(tess);
+
+      gluDeleteTess(tess);
+#else
+      glEnd();
+#endif
+    }
+  };
+};
+
+/*
+** 指標による出力
+**   節点ごとの断面の頂点を一度だけ mesh (Mesh::Part) に書き込み, その前後の側面の
+**   三角形ストリップは断面の頂点番号で作る. 断面の頂点の法線は前後の節間の回転で求めた
+**   側面の法線の平均にし, 両端の蓋の三角形ファンは端の断面と同じ位置に蓋の法線を持つ頂点を
+**   別に追加して作る（側面の法線を蓋に使うと陰影が丸くなる）
+*/
+template <typename T>
+class Indexed {
+  typename Mesh<T>::Part &mesh;   // 出力先
+  unsigned int last[2];           // 今の断面と前の断面の最初の頂点番号（この順）
+
+public:
+  Indexed(typename Mesh<T>::Part &mesh) : mesh(mesh) { last[0] = last[1] = 0; };
+
+  /*
+  ** 断面を追加する
+  **   p:  断面の頂点位置
+  **   nc: 断面の頂点数
+  **   n:  断面の法線ベクトル
+  **   m1: 断面に進入する節間の断面の回転の変換行列
+  **   m2: 断面から退出する節間の断面の回転の変換行列
+  */
+  void ring(const T p[][3], int nc, const double n[][EXTRUSION_CS_LIMIT], const double m1[], const double m2[])
+  {
+    last[1] = last[0];
+
+    // 前後の回転の和で断面全体の法線ベクトルを回転して正規化する
+    const double m[] = {
+      m1[0] + m2[0], m1[1] + m2[1], m1[2] + m2[2],
+      m1[3] + m2[3], m1[4] + m2[4], m1[5] + m2[5],
+    };
+    double r[3][EXTRUSION_CS_LIMIT];
+    rotate(n, nc, m, r);
+    Simd::normalize(r[0], r[1], r[2], nc);
+
+    for (int i = 0; i < nc; ++i) {
+      mesh.normal(static_cast<T>(r[0][i]), static_cast<T>(r[1][i]), static_cast<T>(r[2][i]));
+      const unsigned int k = mesh.point(p[i]);
+      if (i == 0) last[0] = k;
+    }
+  };
+
+  // 今の断面と前の断面の間の側面を作る
+  void side(const T p1[][3], const T p2[][3], const double n[][EXTRUSION_CS_LIMIT], int nc, const double m[])
+  {
+    mesh.begin(GL_TRIANGLE_STRIP);
+    for (int i = 0; i < nc; ++i) {
+      mesh.element(last[0] + i);
+      mesh.element(last[1] + i);
+    }
+    mesh.element(last[0]);
+    mesh.element(last[1]);
+    mesh.end();
+  };
+
+  // 今の断面の n1 番目から n2 番目の頂点の位置に法線 n の頂点を追加して蓋を作る
+  void cap(const T p[][3], int n1, int n2, const double n[])
+  {
+    if (n1 != n2) {
+      const int d = n1 < n2 ? 1 : -1;
+      const int nq = (n2 - n1) * d + 1;
+      unsigned int first = 0;
+
+      // 逆順にたどるときは裏から見るので法線を反転する
+      if (n1 < n2) mesh.normal(static_cast<T>(n[0]), static_cast<T>(n[1]), static_cast<T>(n[2]));
+      else mesh.normal(static_cast<T>(-n[0]), static_cast<T>(-n[1]), static_cast<T>(-n[2]));
+
+      for (int i = 0; i < nq; ++i) {
+        const unsigned int k = mesh.point(p[n1 + i * d]);
+        if (i == 0) first = k;
+      }
+
+      mesh.begin(GL_TRIANGLE_FAN);
+      for (int i = 0; i < nq; ++i) mesh.element(first + i);
+      mesh.end();
+    }
+  };
+};
+
+/*
+** 押し出し
+**   cs:  断面形状 (cross section)
+**   nc:  断面の頂点数
+**   sp:  押し出す経路 (spine)
+**   ns:  経路の節点の数（起点と終点を含む）
+**   out: 出力先
+**   頂点位置は T (float か double) で受け取って出力するが, 断面の向きの計算は
+**   節点ごとに回転を積み重ねるので double で行う
+*/
+template <typename T, typename O>
+static void sweep(const T cs[][2], int nc, const T sp[][3], int ns, O &out)
+{
+  if (--ns > 0) {
+    
+    /* あんまり頂点数の多い断面は切り詰める */
+    if (nc > EXTRUSION_CS_LIMIT) nc = EXTRUSION_CS_LIMIT;
+    
+    /* 断面の頂点位置 c を成分ごとの配列にする（断面全体をまとめて変換する） */
+    double c[2][EXTRUSION_CS_LIMIT];
+    
+    for (int i = 0; i < nc; ++i) {
+      c[0][i] = cs[i][0];
+      c[1][i] = cs[i][1];
+    }
+    
+    /* 断面の法線ベクトル n も成分ごとに求める (z = 0) */
+    double n[2][EXTRUSION_CS_LIMIT], x, y, a;
+    
+    for (int i = 0, j = nc - 1; i < nc; j = i++) {
+      x = cs[i][0] - cs[j][0];
+      y = cs[i][1] - cs[j][1];
+      a = x * x + y * y;
+      
+      if (a != 0.0) {
+        a = sqrt(a);
+        n[0][i] = y / a;
+        n[1][i] = -x / a;
+      }
+      else
+        n[0][i] = n[1][i] = 0.0;
+    }
+    
+    /* 接点に進入・退出する線分の方向ベクトル v */
+    double v[2][3];
+
+    /* 断面の軸ベクトル（断面はXY平面上で定義） */
+    v[0][0] = 0.0;
+    v[0][1] = 0.0;
+    v[0][2] = 1.0;
+    
+    /* 起点の進入側の方向ベクトルは退出側の方向ベクトルと一致させる */
+    v[1][0] = sp[1][0] - sp[0][0];
+    v[1][1] = sp[1][1] - sp[0][1];
+    v[1][2] = sp[1][2] - sp[0][2];
+    a = sqrt(v[1][0] * v[1][0] + v[1][1] * v[1][1] + v[1][2] * v[1][2]);
+    v[1][0] /= a;
+    v[1][1] /= a;
+    v[1][2] /= a;
+    
+    /* 断面を起点における進入側の方向ベクトルの向きに回転する行列 m */
+    double m[9];
+    turn(v[0], v[1], m);
+    
+    /* 接点における断面の頂点位置 p は断面の座標値を m で変換して求める */
+    T p[2][EXTRUSION_CS_LIMIT][3];
+    transform(c, nc, m, sp[0], p[1]);
+    
+    /* 起点の断面を描く */
+    out.ring(p[1], nc, n, m, m);
+    out.cap(p[1], nc - 1, 0, v[1]);
+    
+    /* 侵入側・退出側の切り替え */
+    int k = 0;
+    
+    for (int i = 1; i < ns; ++i) {
+      
+      /* 退出側の方向ベクトル */
+      v[k][0] = sp[i + 1][0] - sp[i][0];
+      v[k][1] = sp[i + 1][1] - sp[i][1];
+      v[k][2] = sp[i + 1][2] - sp[i][2];
+      a = sqrt(v[k][0] * v[k][0] + v[k][1] * v[k][1] + v[k][2] * v[k][2]);
+      v[k][0] /= a;
+      v[k][1] /= a;
+      v[k][2] /= a;
+      
+      /* 中間ベクトル＝断面の法線ベクトル */
+      double h[] = {
+        v[k][0] + v[1 - k][0],
+        v[k][1] + v[1 - k][1],
+        v[k][2] + v[1 - k][2],
+      };
+      
+      /* 中間ベクトル h に直交する断面を求める変換 r */
+      double r[9];
+      shear(h, m, r);
+
+      /* 中間ベクトル h における断面形状を求める */
+      transform(c, nc, r, sp[i], p[k]);
+      
+      /* 進入側の方向ベクトルを退出側の方向ベクトルに回転する行列 r */
+      turn(v[1 - k], v[k], r);
+      
+      /* 断面を退出側の方向ベクトルの向きに回転する行列 e */
+      double e[9];
+      multiply(m, r, e);
+      
+      /* 側面を描く */
+      out.ring(p[k], nc, n, m, e);
+      out.side(p[k], p[1 - k], n, nc, m);
+      
+      /* 退出側の向きを次の節間の断面の向きにする */
+      for (int j = 0; j < 9; ++j) m[j] = e[j];
+      
+      /* 進入側と退出側を入れ替える */
+      k = 1 - k;
+    }
+    
+    /* 終点の断面はひとつ前の断面と同じ向きで位置のみが異なる */
+    transform(c, nc, m, sp[ns], p[k]);
+    
+    /* 側面を描く */
+    out.ring(p[k], nc, n, m, m);
+    out.side(p[k], p[1 - k], n, nc, m);
+    
+    /* 終点の断面を描く */
+    out.cap(p[k], 0, nc - 1, v[1 - k]);
+  }
+}
+
+/*
+** 押し出し形状の描画
+*/
+template <typename T>
+void extrusion(const T cs[][2], int nc, const T sp[][3], int ns)
+{
+  Immediate<T> out;
+  sweep(cs, nc, sp, ns, out);
+}
+
+/*
+** 押し出し形状の確保した配列への作成
+**   頂点と図形を part の位置から書き込む（書き込む数は extrusionSize で求まる）
+*/
+template <typename T>
+void extrusion(const T cs[][2], int nc, const T sp[][3], int ns, typename Mesh<T>::Part &part)
+{
+  Indexed<T> out(part);
+  sweep(cs, nc, sp, ns, out);
+}
+
+/*
+** 押し出し形状の大きさ
+**   断面の頂点数 nc, 経路の節点の数 ns の押し出し形状を作成したときの
+**   頂点数を size[0], 指標の数を size[1], 図形の数を size[2] に格納する
+*/
+void extrusionSize(int nc, int ns, int size[3])
+{
+  if (nc > EXTRUSION_CS_LIMIT) nc = EXTRUSION_CS_LIMIT;
+
+  if (ns > 1) {
+    // 節点ごとに断面, 節間ごとに側面, 断面が多角形なら両端に断面と同じ数の頂点の蓋を作る
+    const int ncap = nc > 1 ? 2 : 0;
+    size[0] = (ns + ncap) * nc;
+    size[1] = (ns - 1) * 2 * (nc + 1) + ncap * nc;
+    size[2] = (ns - 1) + ncap;
+  }
+  else
+    size[0] = size[1] = size[2] = 0;
+}
+
+/*
+** 使う頂点位置の型の実体化
+*/
+template void extrusion<float>(const float cs[][2], int nc, const float sp[][3], int ns);
+template void extrusion<double>(const double cs[][2], int nc, const double sp[][3], int ns);
+template void extrusion<float>(const float cs[][2], int nc, const float sp[][3], int ns, Mesh<float>::Part &part);
+template void extrusion<double>(const double cs[][2], int nc, const double sp[][3], int ns, Mesh<double>::Part &part);
@@ -1,7 +1,15 @@
-/*
-** o`̍쐬
-*/
-
-#define EXTRUSION_CS_LIMIT 100  /* fʂ̒_̍őliʐj */
-
-extern void extrusion(const double cs[][2], int nc, const double sp[][3], int ns);
+/*
+** 押し出し形状の作成
+*/
+
+#define EXTRUSION_CS_LIMIT 100  /* 断面の頂点数の最大値（＝側面数） */
+
+#include "Mesh.h"
+
+template <typename T>
+extern void extrusion(const T cs[][2], int nc, const T sp[][3], int ns);
+
+template <typename T>
+extern void extrusion(const T cs[][2], int nc, const T sp[][3], int ns, typename Mesh<T>::Part &part);
+
+extern void extrusionSize(int nc, int ns, int size[3]);
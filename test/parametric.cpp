@@ -0,0 +1,53 @@
+/*
+** パラメータ付きの L-System の規則の解析のテスト
+*/
+#include <cstdio>
+#include <cstring>
+#include "Parametric.h"
+
+static int failed = 0;
+
+/*
+** 記号 c に実引数 a の規則を当てはめた後続のモジュール列が symbol になるか調べる（0 なら当てはまらない）
+*/
+static void expect(const char * const *rule, char c, double a, const char *symbol)
+{
+  const Parametric g("X(1)", rule);
+  double r[Program::LIMIT], v[Program::LIMIT];
+  const Parametric::Successor *m = g.apply(c, &a, 1, r, v);
+
+  if (!g.errors().empty() || (m == 0) != (symbol == 0) || (m != 0 && m->symbol != symbol)) {
+    printf("FAILED: %s (%c(%g)): %s\n", rule[0], c, a, m != 0 ? m->symbol.c_str() : "(none)");
+    ++failed;
+  }
+}
+
+int main()
+{
+  // 後続のモジュール列の中の - と > の並びは条件の矢印ではない
+  static const char * const r1[] = { "X(n):F(n)[+>X(n)]-<X(n)", 0 };
+  static const char * const r2[] = { "X(n):F(n)[->X(n)]+<X(n)", 0 };
+  expect(r1, 'X', 1.0, "F[+>X]-<X");
+  expect(r2, 'X', 1.0, "F[->X]+<X");
+
+  // 条件は先頭の式の直後に "->" が続くときだけ
+  static const char * const r3[] = { "X(n):n<3->F(n)[->X(n+1)]", 0 };
+  expect(r3, 'X', 1.0, "F[->X]");
+  expect(r3, 'X', 5.0, 0);
+
+  // 減算の後の "->" も矢印
+  static const char * const r4[] = { "X(n):n-1->F(n)->X(n-1)", 0 };
+  expect(r4, 'X', 2.0, "F->X");
+  expect(r4, 'X', 1.0, 0);
+
+  // 形式が正しくない規則は報告する
+  static const char * const r5[] = { "X(n):F(n", 0 };
+  const Parametric g("X(1)", r5);
+  if (g.errors().size() != 1) {
+    printf("FAILED: %s is not reported\n", r5[0]);
+    ++failed;
+  }
+
+  if (failed == 0) printf("parametric: OK\n");
+  return failed > 0 ? 1 : 0;
+}